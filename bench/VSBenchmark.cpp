@@ -0,0 +1,78 @@
+#include "VSBenchmark.h"
+
+#include <iomanip>
+#include <algorithm>
+
+void VSBenchmark::add(std::string name, Function function)
+{
+    m_benchmarks.emplace_back(std::move(name), std::move(function));
+}
+
+auto VSBenchmark::run(const std::string& filter, std::chrono::duration<double> minTime, std::ostream& log) const -> std::vector<Result>
+{
+    using namespace std::chrono;
+    std::vector<Result> results;
+    for (const auto& [name, function] : m_benchmarks)
+    {
+        if (name.find(filter) == std::string::npos) {
+            continue;
+        }
+        VSBenchmarkState state{1};
+        for (;;)
+        {
+            function(state);
+            auto wallTime = state.wallTime;
+            auto cpuTime = state.cpuTime;
+            if (wallTime >= minTime)
+            {
+                results.push_back({
+                    name, state.iterations,
+                    duration<double, std::nano>(wallTime).count() / state.iterations,
+                    duration<double, std::nano>(cpuTime).count() / state.iterations,
+                    state.bytesPerIteration
+                });
+                break;
+            }
+            //Predict iterations needed to reach min time, but grow at most 10 times at once.
+            double scale = wallTime.count() > 0 ? minTime / wallTime * 1.4 : 10;
+            state.iterations = static_cast<size_t>(state.iterations * std::clamp(scale, 2.0, 10.0));
+        }
+        const auto& result = results.back();
+        log << std::left << std::setw(48) << result.name << std::right
+            << std::setw(16) << std::fixed << std::setprecision(0) << result.realTimeNs << " ns"
+            << std::setw(16) << result.cpuTimeNs << " ns"
+            << std::setw(12) << result.iterations;
+        if (result.bytesPerIteration) {
+            log << std::setw(12) << std::setprecision(1) << result.bytesPerIteration / result.realTimeNs << " GB/s";
+        }
+        log << std::endl;
+    }
+    return results;
+}
+
+void VSBenchmark::writeJson(std::ostream& stream, const std::vector<Result>& results)
+{
+    stream << "{\n  \"context\": {\"library_build_type\": "
+#ifdef NDEBUG
+           << "\"release\""
+#else
+           << "\"debug\""
+#endif
+           << "},\n  \"benchmarks\": [";
+    stream << std::setprecision(6) << std::fixed;
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const auto& result = results[i];
+        stream << (i == 0 ? "\n" : ",\n")
+               << "    {\"name\": \"" << result.name << "\", \"run_type\": \"iteration\""
+               << ", \"iterations\": " << result.iterations
+               << ", \"real_time\": " << result.realTimeNs
+               << ", \"cpu_time\": " << result.cpuTimeNs
+               << ", \"time_unit\": \"ns\"";
+        if (result.bytesPerIteration) {
+            stream << ", \"bytes_per_second\": " << result.bytesPerIteration / result.realTimeNs * 1e9;
+        }
+        stream << "}";
+    }
+    stream << "\n  ]\n}" << std::endl;
+}
@@ -0,0 +1,77 @@
+#ifndef VS_BENCHMARK
+#define VS_BENCHMARK
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <ostream>
+#include <chrono>
+
+#include "VSProfiler.h"
+
+/// @brief State passed to benchmark function,
+/// function must prepare its data and pass measured code to measure.
+struct VSBenchmarkState
+{
+    size_t iterations;
+    /// @brief If set by function, throughput is reported.
+    size_t bytesPerIteration = 0;
+    std::chrono::duration<double> wallTime{0};
+    std::chrono::duration<double> cpuTime{0};
+
+    /// @brief Executes body iterations times and records elapsed time.
+    template<typename Body>
+    void measure(Body body)
+    {
+        auto cpuStart = VSProfiler::processCpuTime();
+        auto wallStart = std::chrono::steady_clock::now();
+        for (size_t i = 0; i < iterations; ++i) {
+            body();
+        }
+        wallTime = std::chrono::steady_clock::now() - wallStart;
+        cpuTime = VSProfiler::processCpuTime() - cpuStart;
+    }
+};
+
+/// @brief Minimal benchmark harness, reports in Google Benchmark compatible json,
+/// so its comparison tools can be used on results.
+class VSBenchmark
+{
+public:
+    using Function = std::function<void(VSBenchmarkState&)>;
+
+    struct Result
+    {
+        std::string name;
+        size_t iterations;
+        /// @brief Per iteration.
+        double realTimeNs;
+        double cpuTimeNs;
+        size_t bytesPerIteration;
+    };
+
+    void add(std::string name, Function function);
+
+    /// @brief Runs benchmarks which names contain filter,
+    /// each for at least minTime, printing progress to log.
+    std::vector<Result> run(const std::string& filter, std::chrono::duration<double> minTime, std::ostream& log) const;
+
+    static void writeJson(std::ostream& stream, const std::vector<Result>& results);
+
+private:
+    std::vector<std::pair<std::string, Function>> m_benchmarks;
+};
+
+/// @brief Prevents compiler from optimizing away computation of value.
+template<typename T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static const void* volatile sink;
+    sink = &value;
+#endif
+}
+
+#endif //VS_BENCHMARK
@@ -0,0 +1,155 @@
+//Exercises VSAsyncLibreOffice against the fake LibreOffice library and measures cost of submission.
+//Exits with 1 if facade breaks its contract: order of operations, delivery of results and exceptions,
+//use and destruction of office on its own thread.
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+
+#include "VSAsyncLibreOffice.h"
+
+#ifndef LOKIT_FAKE_LOK_DIR
+#define LOKIT_FAKE_LOK_DIR ""
+#endif
+#ifndef LOKIT_TEST_DOCUMENTS_DIR
+#define LOKIT_TEST_DOCUMENTS_DIR ""
+#endif
+
+namespace
+{
+int failures = 0;
+
+void check(bool condition, const std::string& description)
+{
+    std::cout << (condition ? "ok   " : "FAIL ") << description << std::endl;
+    if (!condition) {
+        ++failures;
+    }
+}
+
+template<typename Function>
+double microsecondsPer(int iterations, Function function)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; ++i) {
+        function();
+    }
+    std::chrono::duration<double, std::micro> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count() / iterations;
+}
+}
+
+int main(int argc, char** argv)
+{
+    std::string libreOfficePath = argc > 1 ? argv[1] : LOKIT_FAKE_LOK_DIR;
+    std::string documentsDir = argc > 2 ? argv[2] : LOKIT_TEST_DOCUMENTS_DIR;
+    if (libreOfficePath.empty() || documentsDir.empty())
+    {
+        std::cerr << "Usage: lokit_async_bench PATH_TO_LIBRE_OFFICE TEST_DOCUMENTS_DIR" << std::endl;
+        return 2;
+    }
+
+    std::thread::id officeThread;
+    bool isPendingExecuted = false;
+    {
+        VSAsyncLibreOffice libreOffice;
+        auto initError = libreOffice.init(libreOfficePath);
+        auto openError = libreOffice.open(documentsDir + "/test.odp");
+        //Submitted without waiting, so init and open must be executed in order.
+        auto initResult = initError.get();
+        check(!initResult, "init " + (initResult ? initResult->message() : libreOfficePath));
+        auto openResult = openError.get();
+        check(!openResult, "open after init submitted back to back");
+        if (initResult || openResult) {
+            return 1;
+        }
+
+        officeThread = libreOffice.submit([](VSLibreOffice&) { return std::this_thread::get_id(); }).get();
+        check(officeThread != std::this_thread::get_id(), "operations run on office thread");
+
+        //Accessed only by operations, which run one after another on office thread.
+        std::vector<int> executed;
+        std::vector<std::future<bool>> isOnOfficeThread;
+        for (int i = 0; i < 1000; ++i)
+        {
+            isOnOfficeThread.push_back(libreOffice.submit([&executed, i, officeThread](VSLibreOffice&) {
+                executed.push_back(i);
+                return std::this_thread::get_id() == officeThread;
+            }));
+        }
+        bool isEveryOnOfficeThread = true;
+        for (auto& result : isOnOfficeThread) {
+            isEveryOnOfficeThread = result.get() && isEveryOnOfficeThread;
+        }
+        bool isOrdered = executed.size() == 1000;
+        for (size_t i = 0; isOrdered && i < executed.size(); ++i) {
+            isOrdered = executed[i] == static_cast<int>(i);
+        }
+        check(isOrdered, "back to back submissions execute in order of submission");
+        check(isEveryOnOfficeThread, "back to back submissions execute on the same thread");
+
+        int partCount = libreOffice.partCount().get();
+        check(partCount > 0, "partCount");
+        std::vector<std::future<std::vector<unsigned char>>> renders;
+        for (int i = 0; i < partCount; ++i) {
+            renders.push_back(libreOffice.renderPart(i, 320, 240));
+        }
+        bool isEveryRendered = true;
+        for (auto& render : renders) {
+            isEveryRendered = render.get().size() == 320u * 240 * VSLibreOffice::bytesPerPixel && isEveryRendered;
+        }
+        check(isEveryRendered, "renderPart of every part submitted back to back");
+
+        auto throwing = libreOffice.submit([](VSLibreOffice&) -> int {
+            throw std::runtime_error("operation failed");
+        });
+        bool isThrown = false;
+        try {
+            throwing.get();
+        }
+        catch (const std::runtime_error& e) {
+            isThrown = std::string(e.what()) == "operation failed";
+        }
+        check(isThrown, "exception of operation reaches its future");
+        check(libreOffice.partCount().get() == partCount, "operations after exception still execute");
+
+        check(!libreOffice.open(documentsDir + "/test.odt").get(), "open text document");
+        auto searchResult = libreOffice.renderSearchResult(R"(<indexing><paragraph node_type="writer" index="0"/></indexing>)").get();
+        check(searchResult && searchResult->width > 0 && searchResult->height > 0
+              && searchResult->pixels.size() == static_cast<size_t>(searchResult->width) * searchResult->height * VSLibreOffice::bytesPerPixel,
+              "renderSearchResult");
+
+        double submitMicroseconds = microsecondsPer(10000, [&] {
+            libreOffice.submit([](VSLibreOffice& office) { return office.isOpened(); }).get();
+        });
+        std::vector<std::future<void>> pending;
+        double pipelinedMicroseconds = microsecondsPer(1, [&] {
+            for (int i = 0; i < 10000; ++i) {
+                pending.push_back(libreOffice.submit([](VSLibreOffice&) {}));
+            }
+            for (auto& operation : pending) {
+                operation.get();
+            }
+        }) / 10000;
+        std::cout << "submit and wait: " << submitMicroseconds << " us, back to back submission: " << pipelinedMicroseconds << " us" << std::endl;
+
+        //Left opened and inited, destructor executes submitted operations and deinitializes office on its thread,
+        //fake library aborts if office is destroyed on other thread.
+        libreOffice.submit([&isPendingExecuted](VSLibreOffice&) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            isPendingExecuted = true;
+        });
+    }
+    check(isPendingExecuted, "destruction executes submitted operations and deinitializes office on its thread");
+
+    {
+        VSAsyncLibreOffice libreOffice;
+        check(!libreOffice.init(libreOfficePath).get(), "init again");
+        libreOffice.deinit().get();
+        check(!libreOffice.submit([](VSLibreOffice& office) { return office.isInited(); }).get(), "deinit");
+    }
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,308 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <map>
+#include <string>
+#include <optional>
+#include <chrono>
+#include <algorithm>
+#include <iomanip>
+#include <cmath>
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/value_semantic.hpp>
+#include <boost/program_options/variables_map.hpp>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <sys/resource.h>
+#endif
+
+namespace bpo = boost::program_options;
+namespace bfs = boost::filesystem;
+namespace bpt = boost::property_tree;
+
+struct ProcessResult
+{
+    int exitCode;
+    size_t peakResidentSetSize;
+};
+
+/// @brief Runs process, redirecting its standard output to file, and waits for its exit.
+/// @return nullopt if process could not be started.
+std::optional<ProcessResult> runProcess(const std::vector<std::string>& arguments, const std::string& stdoutPath)
+{
+#ifdef _WIN32
+    std::string commandLine;
+    for (const auto& argument : arguments) {
+        commandLine += (commandLine.empty() ? "\"" : " \"") + argument + "\"";
+    }
+    SECURITY_ATTRIBUTES inheritable{sizeof(SECURITY_ATTRIBUTES), nullptr, TRUE};
+    HANDLE output = CreateFileA(stdoutPath.c_str(), GENERIC_WRITE, FILE_SHARE_READ, &inheritable, CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (output == INVALID_HANDLE_VALUE) {
+        return std::nullopt;
+    }
+    STARTUPINFOA startupInfo{};
+    startupInfo.cb = sizeof(startupInfo);
+    startupInfo.dwFlags = STARTF_USESTDHANDLES;
+    startupInfo.hStdOutput = output;
+    startupInfo.hStdError = GetStdHandle(STD_ERROR_HANDLE);
+    startupInfo.hStdInput = GetStdHandle(STD_INPUT_HANDLE);
+    PROCESS_INFORMATION processInfo{};
+    BOOL created = CreateProcessA(nullptr, commandLine.data(), nullptr, nullptr, TRUE, 0, nullptr, nullptr, &startupInfo, &processInfo);
+    CloseHandle(output);
+    if (!created) {
+        return std::nullopt;
+    }
+    WaitForSingleObject(processInfo.hProcess, INFINITE);
+    DWORD exitCode = 0;
+    GetExitCodeProcess(processInfo.hProcess, &exitCode);
+    PROCESS_MEMORY_COUNTERS counters{};
+    GetProcessMemoryInfo(processInfo.hProcess, &counters, sizeof(counters));
+    CloseHandle(processInfo.hThread);
+    CloseHandle(processInfo.hProcess);
+    return ProcessResult{static_cast<int>(exitCode), counters.PeakWorkingSetSize};
+#else
+    std::vector<char*> argv;
+    for (const auto& argument : arguments) {
+        argv.push_back(const_cast<char*>(argument.c_str()));
+    }
+    argv.push_back(nullptr);
+    pid_t pid = fork();
+    if (pid < 0) {
+        return std::nullopt;
+    }
+    if (pid == 0)
+    {
+        int output = open(stdoutPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (output < 0 || dup2(output, STDOUT_FILENO) < 0) {
+            _exit(127);
+        }
+        execv(argv[0], argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    rusage usage{};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        return std::nullopt;
+    }
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 127) {
+        return std::nullopt;
+    }
+#ifdef __APPLE__
+    size_t peakResidentSetSize = static_cast<size_t>(usage.ru_maxrss);
+#else
+    size_t peakResidentSetSize = static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+    return ProcessResult{WIFEXITED(status) ? WEXITSTATUS(status) : -1, peakResidentSetSize};
+#endif
+}
+
+/// @param percent - in range [0, 100]
+double percentile(std::vector<double> values, double percent)
+{
+    if (values.empty()) {
+        return 0;
+    }
+    std::sort(values.begin(), values.end());
+    //Nearest rank.
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100 * values.size()));
+    return values[std::clamp<size_t>(rank, 1, values.size()) - 1];
+}
+
+struct Scenario
+{
+    std::string name;
+    std::vector<std::string> lokitArguments;
+};
+
+struct Statistics
+{
+    double p50;
+    double p95;
+    double p99;
+};
+
+int main(int argc, char** argv)
+{
+    bpo::options_description options("Options");
+    options.add_options()
+        ("help", "show help")
+        ("lokit", bpo::value<std::string>()->value_name("path")->default_value(LOKIT_EXECUTABLE), "lokit executable")
+#ifdef LOKIT_FAKE_LOK_DIR
+        ("libre-office", bpo::value<std::string>()->value_name("path")->default_value(LOKIT_FAKE_LOK_DIR), "LibreOffice program directory, stand-in library by default")
+#else
+        ("libre-office", bpo::value<std::string>()->value_name("path")->required(), "LibreOffice program directory")
+#endif
+        ("documents", bpo::value<std::string>()->value_name("path")->default_value(LOKIT_TEST_DOCUMENTS_DIR), "directory with test.odp, test2.odp and test.odt")
+        ("corpus", bpo::value<std::string>()->value_name("path"), "directory with additional documents, all its files are used")
+        ("iterations", bpo::value<int>()->value_name("count")->default_value(5), "runs of each scenario per document")
+        ("resolution", bpo::value<std::string>()->value_name("WxH")->default_value("1920x1080"), "resolution of image export scenario")
+        ("work-dir", bpo::value<std::string>()->value_name("path")->default_value("lokit_e2e_bench_output"), "directory for outputs of runs")
+        ("json", bpo::value<std::string>()->value_name("path"), "write results as json, usable as baseline")
+        ("baseline", bpo::value<std::string>()->value_name("path"), "fail if results exceed baseline results")
+        ("threshold", bpo::value<double>()->value_name("ratio")->default_value(0.2), "allowed relative excess over baseline")
+        ("min-ms", bpo::value<double>()->value_name("ms")->default_value(1.0), "excess below which regressions are ignored, in milliseconds for stages and megabytes for memory");
+    bpo::variables_map optionValues;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, options), optionValues);
+        if (optionValues.count("help")) {
+            std::cout << "Usage: lokit_e2e_bench [--options]" << std::endl << options << std::endl;
+            return 0;
+        }
+        bpo::notify(optionValues);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    constexpr int regressionReturnCode = 1;
+    constexpr int failedRunReturnCode = 2;
+
+    bfs::path documentsDir(optionValues["documents"].as<std::string>());
+    std::vector<bfs::path> documents = {documentsDir / "test.odp", documentsDir / "test2.odp", documentsDir / "test.odt"};
+    if (optionValues.count("corpus"))
+    {
+        std::vector<bfs::path> corpus;
+        for (const auto& entry : bfs::directory_iterator(optionValues["corpus"].as<std::string>()))
+        {
+            if (bfs::is_regular_file(entry.status())) {
+                corpus.push_back(entry.path());
+            }
+        }
+        std::sort(corpus.begin(), corpus.end());
+        documents.insert(documents.end(), corpus.begin(), corpus.end());
+    }
+
+    bfs::path workDir = bfs::absolute(optionValues["work-dir"].as<std::string>());
+    bfs::create_directories(workDir);
+    const std::vector<Scenario> scenarios = {
+        {"convert", {"--convert-to", "pdf", "--output-file", (workDir / "converted.pdf").string()}},
+        {"images", {"--export-as-images", "png", "--resolution", optionValues["resolution"].as<std::string>(), "--output-dir", workDir.string()}}
+    };
+
+    //Key is scenario/document/measure, measures are stage wall times in ms, run wall time and peak RSS in MB.
+    std::map<std::string, std::vector<double>> samples;
+    std::vector<std::string> keyOrder;
+    auto addSample = [&](const std::string& key, double value) {
+        auto [found, inserted] = samples.try_emplace(key);
+        if (inserted) {
+            keyOrder.push_back(key);
+        }
+        found->second.push_back(value);
+    };
+
+    int iterations = optionValues["iterations"].as<int>();
+    std::string timingsPath = (workDir / "timings.json").string();
+    for (const auto& scenario : scenarios)
+    {
+        for (const auto& document : documents)
+        {
+            std::string prefix = scenario.name + "/" + document.filename().string() + "/";
+            for (int i = 0; i < iterations; ++i)
+            {
+                std::vector<std::string> arguments = {
+                    optionValues["lokit"].as<std::string>(), optionValues["libre-office"].as<std::string>(), document.string(), "--timings=json"
+                };
+                arguments.insert(arguments.end(), scenario.lokitArguments.begin(), scenario.lokitArguments.end());
+                auto start = std::chrono::steady_clock::now();
+                auto result = runProcess(arguments, timingsPath);
+                std::chrono::duration<double, std::milli> wallTime = std::chrono::steady_clock::now() - start;
+                if (!result || result->exitCode != 0) {
+                    std::cerr << "Run of " << prefix << " failed" << std::endl;
+                    return failedRunReturnCode;
+                }
+                bpt::ptree timings;
+                try {
+                    bpt::read_json(timingsPath, timings);
+                }
+                catch (const bpt::json_parser_error& e) {
+                    std::cerr << "Unable to parse timings of " << prefix << ": " << e.what() << std::endl;
+                    return failedRunReturnCode;
+                }
+                for (const auto& [stage, total] : timings.get_child("totals")) {
+                    addSample(prefix + stage, total.get<double>("wall_ms"));
+                }
+                addSample(prefix + "run", wallTime.count());
+                addSample(prefix + "peak_rss_mb", result->peakResidentSetSize / (1024.0 * 1024.0));
+            }
+        }
+    }
+
+    std::map<std::string, Statistics> statistics;
+    std::cout << std::left << std::setw(56) << "measure" << std::right
+              << std::setw(12) << "p50" << std::setw(12) << "p95" << std::setw(12) << "p99" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    for (const auto& key : keyOrder)
+    {
+        const auto& values = samples.at(key);
+        Statistics keyStatistics{percentile(values, 50), percentile(values, 95), percentile(values, 99)};
+        statistics[key] = keyStatistics;
+        std::cout << std::left << std::setw(56) << key << std::right
+                  << std::setw(12) << keyStatistics.p50 << std::setw(12) << keyStatistics.p95 << std::setw(12) << keyStatistics.p99 << std::endl;
+    }
+
+    if (optionValues.count("json"))
+    {
+        bpt::ptree results;
+        for (const auto& key : keyOrder)
+        {
+            bpt::ptree keyResults;
+            keyResults.put("p50", statistics[key].p50);
+            keyResults.put("p95", statistics[key].p95);
+            keyResults.put("p99", statistics[key].p99);
+            //Keys contain dots, which are path separators for put.
+            results.push_back({key, keyResults});
+        }
+        bpt::ptree root;
+        root.add_child("results", results);
+        bpt::write_json(optionValues["json"].as<std::string>(), root);
+    }
+
+    if (optionValues.count("baseline"))
+    {
+        bpt::ptree baseline;
+        try {
+            bpt::read_json(optionValues["baseline"].as<std::string>(), baseline);
+        }
+        catch (const bpt::json_parser_error& e) {
+            std::cerr << "Unable to read baseline: " << e.what() << std::endl;
+            return failedRunReturnCode;
+        }
+        double threshold = optionValues["threshold"].as<double>();
+        double minExcess = optionValues["min-ms"].as<double>();
+        bool regressed = false;
+        for (const auto& [key, baselineResults] : baseline.get_child("results"))
+        {
+            auto current = statistics.find(key);
+            if (current == statistics.end()) {
+                continue;
+            }
+            //p99 of few iterations is too noisy to be compared.
+            for (const auto& [name, value] : {std::pair{"p50", current->second.p50}, std::pair{"p95", current->second.p95}})
+            {
+                double baselineValue = baselineResults.get<double>(name);
+                if (value > baselineValue * (1 + threshold) && value - baselineValue > minExcess)
+                {
+                    std::cerr << "Regression in " << key << " " << name << ": " << value << " > baseline " << baselineValue << std::endl;
+                    regressed = true;
+                }
+            }
+        }
+        if (regressed) {
+            return regressionReturnCode;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,293 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <list>
+#include <forward_list>
+#include <numeric>
+#include <memory>
+
+#include "VSBenchmark.h"
+#include "VSUtils.h"
+#include "VSLibreOffice.h"
+#include "VSImageScaling.h"
+#include "VSPixelConversion.h"
+#include "VSHash.h"
+
+#include <boost/program_options/options_description.hpp>
+#include <boost/program_options/parsers.hpp>
+#include <boost/program_options/value_semantic.hpp>
+#include <boost/program_options/variables_map.hpp>
+
+#include <QImage>
+#include <QBuffer>
+#include <QByteArray>
+
+namespace bpo = boost::program_options;
+
+struct Resolution {
+    const char* name;
+    int width;
+    int height;
+};
+
+const Resolution benchmarkResolutions[] = {{"1080p", 1920, 1080}, {"4K", 3840, 2160}};
+
+/// @brief Makes slide like premultiplied ARGB32 buffer: white background,
+/// a few colored blocks and semi transparent noise resembling text.
+std::vector<unsigned char> makeSyntheticRender(int width, int height)
+{
+    std::vector<unsigned char> buffer(static_cast<size_t>(width) * height * VSLibreOffice::bytesPerPixel);
+    unsigned int random = 12345;
+    for (int y = 0; y < height; ++y)
+    {
+        for (int x = 0; x < width; ++x)
+        {
+            unsigned char* pixel = &buffer[(static_cast<size_t>(y) * width + x) * VSLibreOffice::bytesPerPixel];
+            //Memory order is BGRA on little endian.
+            unsigned char b = 255, g = 255, r = 255, a = 255;
+            if (x > width / 10 && x < width / 2 && y > height / 5 && y < height / 3) {
+                b = 200; g = 80; r = 30;
+            }
+            else if (y > height / 2 && y % 24 < 12)
+            {
+                random = random * 1103515245 + 12345;
+                if ((random >> 16) % 3 == 0) {
+                    a = static_cast<unsigned char>(random >> 24);
+                    b = g = r = 0;
+                }
+            }
+            pixel[0] = b; pixel[1] = g; pixel[2] = r; pixel[3] = a;
+        }
+    }
+    return buffer;
+}
+
+template<typename Container>
+void addPermutateBenchmark(VSBenchmark& benchmark, const std::string& containerName, size_t size, size_t permutationSize)
+{
+    benchmark.add(
+        "permutate/" + containerName + "/" + std::to_string(size) + "/" + std::to_string(permutationSize),
+        [size, permutationSize](VSBenchmarkState& state)
+        {
+            std::vector<size_t> values(size);
+            std::iota(values.begin(), values.end(), 0);
+            Container container(values.begin(), values.end());
+            std::vector<size_t> permutation(permutationSize);
+            std::iota(permutation.rbegin(), permutation.rend(), 0);
+            state.measure([&]
+            {
+                auto notPermuted = permutate(container.begin(), container.end(), permutation.begin(), permutation.size());
+                doNotOptimize(notPermuted);
+            });
+            state.bytesPerIteration = size * sizeof(size_t);
+        }
+    );
+}
+
+void addBenchmarks(VSBenchmark& benchmark)
+{
+    constexpr size_t permutatedSize = 1 << 20;
+    for (size_t permutationSize : {2, 4, 16, 256}) {
+        addPermutateBenchmark<std::vector<size_t>>(benchmark, "vector", permutatedSize, permutationSize);
+    }
+    addPermutateBenchmark<std::list<size_t>>(benchmark, "list", permutatedSize, 4);
+    addPermutateBenchmark<std::forward_list<size_t>>(benchmark, "forward_list", permutatedSize, 4);
+
+    for (const auto& resolution : benchmarkResolutions)
+    {
+        size_t bufferSize = static_cast<size_t>(resolution.width) * resolution.height * VSLibreOffice::bytesPerPixel;
+        std::string suffix = std::string("/") + resolution.name;
+
+        benchmark.add("allocate/vector" + suffix, [bufferSize](VSBenchmarkState& state)
+        {
+            state.measure([&]
+            {
+                std::vector<unsigned char> buffer(bufferSize);
+                doNotOptimize(buffer.data());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+        benchmark.add("allocate/uninitialized" + suffix, [bufferSize](VSBenchmarkState& state)
+        {
+            state.measure([&]
+            {
+                std::unique_ptr<unsigned char[]> buffer(new unsigned char[bufferSize]);
+                doNotOptimize(buffer.get());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+
+        benchmark.add("convert/bgra_to_rgba_permutate" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            state.measure([&]
+            {
+                auto notPermuted = permutate(buffer.begin(), buffer.end(), {2, 1, 0, 3});
+                doNotOptimize(notPermuted);
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+        benchmark.add("convert/unpremultiply_qimage" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            QImage rendered(buffer.data(), resolution.width, resolution.height, QImage::Format::Format_ARGB32_Premultiplied);
+            state.measure([&]
+            {
+                QImage converted = rendered.convertToFormat(QImage::Format::Format_ARGB32);
+                doNotOptimize(converted.constBits());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+
+        benchmark.add("convert/rgb888_qimage" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            QImage rendered(buffer.data(), resolution.width, resolution.height, QImage::Format::Format_ARGB32_Premultiplied);
+            state.measure([&]
+            {
+                QImage converted = rendered.convertToFormat(QImage::Format::Format_RGB888);
+                doNotOptimize(converted.constBits());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+        benchmark.add("convert/composite_rgb888" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            const size_t targetStride = (static_cast<size_t>(resolution.width) * 3 + 3) / 4 * 4;
+            std::vector<unsigned char> flattened(targetStride * resolution.height);
+            state.measure([&]
+            {
+                compositeOver(
+                    buffer.data(), resolution.width, resolution.height, static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel,
+                    0xFFFFFF, flattened.data(), targetStride
+                );
+                doNotOptimize(flattened.data());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+
+        benchmark.add("convert/composite_gray8" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            std::vector<unsigned char> gray(static_cast<size_t>(resolution.width) * resolution.height);
+            state.measure([&]
+            {
+                compositeOverGray(
+                    buffer.data(), resolution.width, resolution.height, static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel,
+                    0xFFFFFF, gray.data(), resolution.width
+                );
+                doNotOptimize(gray.data());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+        benchmark.add("convert/quantize_indexed8" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            const size_t rgbStride = static_cast<size_t>(resolution.width) * 3;
+            std::vector<unsigned char> rgb(rgbStride * resolution.height);
+            compositeOver(
+                buffer.data(), resolution.width, resolution.height, static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel,
+                0xFFFFFF, rgb.data(), rgbStride
+            );
+            std::vector<unsigned char> indices(static_cast<size_t>(resolution.width) * resolution.height);
+            state.measure([&]
+            {
+                auto palette = quantizePopularity(rgb.data(), resolution.width, resolution.height, rgbStride, indices.data(), resolution.width);
+                doNotOptimize(palette.data());
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+
+        benchmark.add("hash/xxh64" + suffix, [resolution, bufferSize](VSBenchmarkState& state)
+        {
+            auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+            state.measure([&]
+            {
+                auto hash = hashBytes(buffer.data(), buffer.size());
+                doNotOptimize(hash);
+            });
+            state.bytesPerIteration = bufferSize;
+        });
+
+        for (int divisor : {2, 12})
+        {
+            benchmark.add("downscale/area_" + std::to_string(divisor) + suffix, [resolution, bufferSize, divisor](VSBenchmarkState& state)
+            {
+                auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+                int width = resolution.width / divisor;
+                int height = resolution.height / divisor;
+                std::vector<unsigned char> scaled(static_cast<size_t>(width) * height * VSLibreOffice::bytesPerPixel);
+                state.measure([&]
+                {
+                    downscaleArea(
+                        buffer.data(), resolution.width, resolution.height, static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel,
+                        scaled.data(), width, height, static_cast<size_t>(width) * VSLibreOffice::bytesPerPixel
+                    );
+                    doNotOptimize(scaled.data());
+                });
+                state.bytesPerIteration = bufferSize;
+            });
+        }
+
+        for (const char* format : {"png", "jpg"})
+        {
+            benchmark.add(std::string("encode/") + format + suffix, [resolution, bufferSize, format](VSBenchmarkState& state)
+            {
+                auto buffer = makeSyntheticRender(resolution.width, resolution.height);
+                QImage image = QImage(
+                    buffer.data(), resolution.width, resolution.height, QImage::Format::Format_ARGB32_Premultiplied
+                ).convertToFormat(QImage::Format::Format_ARGB32);
+                state.measure([&]
+                {
+                    QByteArray encoded;
+                    QBuffer encodedBuffer(&encoded);
+                    encodedBuffer.open(QIODevice::WriteOnly);
+                    image.save(&encodedBuffer, format);
+                    doNotOptimize(encoded.constData());
+                });
+                state.bytesPerIteration = bufferSize;
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bpo::options_description options("Options");
+    options.add_options()
+        ("help", "show help")
+        ("filter", bpo::value<std::string>()->value_name("substring")->default_value(""), "run only benchmarks which names contain substring")
+        ("min-time", bpo::value<double>()->value_name("seconds")->default_value(0.5), "minimal time of each benchmark")
+        ("json", bpo::value<std::string>()->value_name("path"), "write results in Google Benchmark compatible json");
+    bpo::variables_map optionValues;
+    try {
+        bpo::store(bpo::parse_command_line(argc, argv, options), optionValues);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    if (optionValues.count("help")) {
+        std::cout << "Usage: lokit_bench [--options]" << std::endl << options << std::endl;
+        return 0;
+    }
+
+    VSBenchmark benchmark;
+    addBenchmarks(benchmark);
+    auto results = benchmark.run(
+        optionValues["filter"].as<std::string>(),
+        std::chrono::duration<double>(optionValues["min-time"].as<double>()),
+        std::cout
+    );
+    if (optionValues.count("json"))
+    {
+        auto jsonPath = optionValues["json"].as<std::string>();
+        std::ofstream jsonFile(jsonPath);
+        VSBenchmark::writeJson(jsonFile, results);
+        if (!jsonFile) {
+            std::cerr << "Unable to write " << jsonPath << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,71 @@
+#Generates header with filter catalog entries for VSFilterCatalog.
+#Usage: cmake -DTYPES=types.txt -DFORMATS=filter_formats.txt -DOUTPUT=VSFilterCatalogData.h -P GenerateFilterCatalog.cmake
+
+file(STRINGS "${TYPES}" filterNames)
+file(STRINGS "${FORMATS}" formatLines REGEX "^[^#]")
+
+set(documentTypes text spreadsheet presentation drawing)
+
+function(escape value result)
+	string(REPLACE "\\" "\\\\" value "${value}")
+	string(REPLACE "\"" "\\\"" value "${value}")
+	set(${result} "${value}" PARENT_SCOPE)
+endfunction()
+
+set(entries "")
+set(exportedNames "")
+foreach(line IN LISTS formatLines)
+	#Matched by regex rather than split to list, since file type may be empty.
+	if(NOT line MATCHES "^([^|]+)\\|([^|]+)\\|([^|]+)\\|([^|]*)$")
+		message(FATAL_ERROR "${FORMATS}: expected name|document types|extension|file type, got: ${line}")
+	endif()
+	set(name "${CMAKE_MATCH_1}")
+	set(types "${CMAKE_MATCH_2}")
+	set(extension "${CMAKE_MATCH_3}")
+	set(fileType "${CMAKE_MATCH_4}")
+	list(FIND filterNames "${name}" nameIndex)
+	if(nameIndex EQUAL -1)
+		message(FATAL_ERROR "${FORMATS}: filter ${name} is not listed in ${TYPES}")
+	endif()
+	string(REPLACE "," ";" types "${types}")
+	set(typeFlags "")
+	foreach(type IN LISTS types)
+		list(FIND documentTypes "${type}" typeIndex)
+		if(typeIndex EQUAL -1)
+			message(FATAL_ERROR "${FORMATS}: unknown document type ${type} of filter ${name}")
+		endif()
+		list(APPEND typeFlags "VSFilterCatalog::${type}")
+	endforeach()
+	string(REPLACE ";" " | " typeFlags "${typeFlags}")
+	string(TOLOWER "${extension}" extension)
+	escape("${name}" name)
+	escape("${fileType}" fileType)
+	string(APPEND entries "    {\"${name}\", ${typeFlags}, \"${extension}\", \"${fileType}\"},\n")
+	list(APPEND exportedNames "${name}")
+endforeach()
+
+#Filters which are not exported by saveAs are still known, e.g. import filters.
+list(REMOVE_DUPLICATES filterNames)
+foreach(name IN LISTS filterNames)
+	escape("${name}" name)
+	list(FIND exportedNames "${name}" exportedIndex)
+	if(exportedIndex EQUAL -1 AND NOT name STREQUAL "")
+		string(APPEND entries "    {\"${name}\", VSFilterCatalog::noDocumentTypes, \"\", \"\"},\n")
+	endif()
+endforeach()
+
+file(WRITE "${OUTPUT}.tmp"
+"//Generated by GenerateFilterCatalog.cmake from types.txt and filter_formats.txt, do not edit.
+#ifndef VS_FILTER_CATALOG_DATA
+#define VS_FILTER_CATALOG_DATA
+
+#include \"VSFilterCatalog.h\"
+
+constexpr VSFilterCatalog::Filter filterCatalogData[] = {
+${entries}};
+
+#endif //VS_FILTER_CATALOG_DATA
+")
+#Header is rewritten only on change, so sources including it are not rebuilt needlessly.
+execute_process(COMMAND ${CMAKE_COMMAND} -E copy_if_different "${OUTPUT}.tmp" "${OUTPUT}")
+file(REMOVE "${OUTPUT}.tmp")
@@ -0,0 +1,681 @@
+//Stand-in for LibreOffice's libsofficeapp implementing LibreOfficeKit vtables,
+//so lokit can be benchmarked and tested without LibreOffice installed.
+//Renders deterministic synthetic parts, behaviour is configured by environment variables:
+//  LOKIT_FAKE_PARTS    - parts count of presentation, spreadsheet and drawing documents, default 4.
+//  LOKIT_FAKE_TEXT_PAGES - pages of text documents, which are their parts, default 1. Like in LibreOffice,
+//                        text selected in text document is text of all pages.
+//  LOKIT_FAKE_DISTINCT_PARTS - count of differently looking parts, next parts repeat them, default all.
+//  LOKIT_FAKE_INIT_MS  - latency of initialization.
+//  LOKIT_FAKE_LOAD_MS  - latency of documentLoad.
+//  LOKIT_FAKE_PAINT_MS - latency of each paintTile call.
+//  LOKIT_FAKE_SAVE_MS  - latency of saveAs.
+//  LOKIT_FAKE_TEXT_MS  - latency of getTextSelection.
+//  LOKIT_FAKE_PROFILE_MS - latency of first start with user profile, which creates the profile.
+//  LOKIT_FAKE_CRASH    - documents whose path contains the value abort process on load.
+//  LOKIT_FAKE_HANG     - documents whose path contains the value never finish loading.
+//  LOKIT_FAKE_FONTS    - comma separated font families used by every document, reported missing unless font file of that name is added.
+//  LOKIT_FAKE_ADD_FONT_MS - latency of each added font.
+//Initialization latency is spent once by lok_preinit if it is called before init.
+//Callbacks are invoked synchronously on calling thread.
+//Like LibreOffice, office must be destroyed on the thread it was created on, otherwise process aborts.
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstdio>
+#include <cstring>
+#include <cctype>
+#include <filesystem>
+
+#define LOK_USE_UNSTABLE_API
+#include <LibreOfficeKit/LibreOfficeKit.h>
+#include <LibreOfficeKit/LibreOfficeKitEnums.h>
+
+#ifdef _WIN32
+#define FAKE_LOK_EXPORT __declspec(dllexport)
+#else
+#define FAKE_LOK_EXPORT __attribute__((visibility("default")))
+#endif
+
+namespace
+{
+
+bool isPreinited = false;
+
+int environmentInt(const char* name, int defaultValue)
+{
+    const char* value = std::getenv(name);
+    return value && *value ? std::atoi(value) : defaultValue;
+}
+
+void sleepFor(const char* latencyVariable)
+{
+    if (int milliseconds = environmentInt(latencyVariable, 0); milliseconds > 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(milliseconds));
+    }
+}
+
+char* copyString(const std::string& string)
+{
+    char* copy = static_cast<char*>(std::malloc(string.size() + 1));
+    std::memcpy(copy, string.c_str(), string.size() + 1);
+    return copy;
+}
+
+long long nowMicroseconds()
+{
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch()).count();
+}
+
+/// @brief Converts file URL to system path, decoding percent encoded characters.
+std::string urlToPath(const std::string& url)
+{
+    std::string path = url.compare(0, 7, "file://") == 0 ? url.substr(7) : url;
+    std::string decoded;
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        if (path[i] == '%' && i + 2 < path.size()) {
+            decoded += static_cast<char>(std::stoi(path.substr(i + 1, 2), nullptr, 16));
+            i += 2;
+        }
+        else {
+            decoded += path[i];
+        }
+    }
+#ifdef _WIN32
+    //file:///C:/path
+    if (decoded.size() > 2 && decoded[0] == '/' && decoded[2] == ':') {
+        decoded.erase(0, 1);
+    }
+#endif
+    return decoded;
+}
+
+std::string extensionOf(const std::string& path)
+{
+    auto dot = path.rfind('.');
+    if (dot == std::string::npos || path.find('/', dot) != std::string::npos) {
+        return {};
+    }
+    std::string extension = path.substr(dot + 1);
+    std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) { return std::tolower(c); });
+    return extension;
+}
+
+int documentTypeOf(const std::string& extension)
+{
+    for (const char* text : {"odt", "fodt", "doc", "docx", "rtf", "txt", "html"}) {
+        if (extension == text) return LOK_DOCTYPE_TEXT;
+    }
+    for (const char* spreadsheet : {"ods", "fods", "xls", "xlsx", "csv"}) {
+        if (extension == spreadsheet) return LOK_DOCTYPE_SPREADSHEET;
+    }
+    for (const char* presentation : {"odp", "fodp", "ppt", "pptx"}) {
+        if (extension == presentation) return LOK_DOCTYPE_PRESENTATION;
+    }
+    for (const char* drawing : {"odg", "fodg", "vsd"}) {
+        if (extension == drawing) return LOK_DOCTYPE_DRAWING;
+    }
+    return LOK_DOCTYPE_OTHER;
+}
+
+struct FakeOffice : LibreOfficeKit
+{
+    std::string error;
+    LibreOfficeKitCallback callback = nullptr;
+    void* callbackData = nullptr;
+    unsigned long long features = 0;
+    bool recordingProfileZones = false;
+    std::string profileZones;
+    /// @brief Names of font files registered by "addfont" option without extension, lowercase.
+    std::vector<std::string> addedFonts;
+    std::thread::id thread = std::this_thread::get_id();
+
+    void notify(int type, const std::string& payload)
+    {
+        if (callback) {
+            callback(type, payload.c_str(), callbackData);
+        }
+    }
+
+    void addProfileZone(const char* name, long long start)
+    {
+        if (recordingProfileZones)
+        {
+            profileZones += "{\"name\":\"" + std::string(name) + "\",\"ph\":\"X\",\"ts\":" + std::to_string(start)
+                + ",\"dur\":" + std::to_string(nowMicroseconds() - start) + ",\"pid\":0,\"tid\":1},\n";
+        }
+    }
+};
+
+struct FakeDocument : LibreOfficeKitDocument
+{
+    FakeOffice* office;
+    std::string path;
+    int type;
+    int parts;
+    int distinctParts;
+    int part = 0;
+    bool isAllSelected = false;
+    long width;
+    long height;
+    LibreOfficeKitCallback callback = nullptr;
+    void* callbackData = nullptr;
+};
+
+FakeOffice* asOffice(LibreOfficeKit* pThis)
+{
+    return static_cast<FakeOffice*>(pThis);
+}
+
+FakeDocument* asDocument(LibreOfficeKitDocument* pThis)
+{
+    return static_cast<FakeDocument*>(pThis);
+}
+
+//Document
+
+/// @brief Paragraphs of text document, each one is a line of "words" painted by fakePixel.
+constexpr int fakeParagraphCount = 12;
+/// @brief Twips between tops of paragraph lines and height of line.
+constexpr long fakeParagraphPitch = 480;
+constexpr long fakeParagraphHeight = 240;
+
+/// @brief Every third paragraph mentions LibreOffice, so searches have several results.
+std::string fakeParagraphText(int index)
+{
+    return "Paragraph " + std::to_string(index + 1) + (index % 3 == 0 ? " mentions LibreOffice." : " is plain.");
+}
+
+/// @brief Writes xml in format of writer_indexing_export filter.
+void writeIndexingXml(const FakeDocument&, std::ostream& stream)
+{
+    stream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<indexing>\n";
+    for (int i = 0; i < fakeParagraphCount; ++i) {
+        stream << "  <paragraph index=\"" << i << "\" node_type=\"writer\">" << fakeParagraphText(i) << "</paragraph>\n";
+    }
+    stream << "  <object alt=\"\" name=\"Shape 1\" object_type=\"shape\">\n"
+           << "    <paragraph index=\"0\" node_type=\"common\">Shape text mentions LibreOffice too.</paragraph>\n"
+           << "  </object>\n</indexing>\n";
+}
+
+void documentDestroy(LibreOfficeKitDocument* pThis)
+{
+    delete asDocument(pThis);
+}
+
+int documentSaveAs(LibreOfficeKitDocument* pThis, const char* pUrl, const char* pFormat, const char*)
+{
+    auto document = asDocument(pThis);
+    auto start = nowMicroseconds();
+    sleepFor("LOKIT_FAKE_SAVE_MS");
+    std::string path = urlToPath(pUrl);
+    std::string format = pFormat ? pFormat : extensionOf(path);
+    std::ofstream file(path, std::ios::binary);
+    if (format == "xml" && document->type == LOK_DOCTYPE_TEXT) {
+        writeIndexingXml(*document, file);
+    }
+    else {
+        file << "lokit fake " << format << " export of " << document->path << "\n";
+    }
+    document->office->addProfileZone("saveAs", start);
+    if (!file) {
+        document->office->error = "Unable to write " + path;
+        return 0;
+    }
+    return 1;
+}
+
+int documentGetDocumentType(LibreOfficeKitDocument* pThis)
+{
+    return asDocument(pThis)->type;
+}
+
+int documentGetParts(LibreOfficeKitDocument* pThis)
+{
+    return asDocument(pThis)->parts;
+}
+
+int documentGetPart(LibreOfficeKitDocument* pThis)
+{
+    return asDocument(pThis)->part;
+}
+
+void documentSetPart(LibreOfficeKitDocument* pThis, int nPart)
+{
+    auto document = asDocument(pThis);
+    if (nPart >= 0 && nPart < document->parts) {
+        document->part = nPart;
+    }
+}
+
+char* documentGetPartName(LibreOfficeKitDocument*, int nPart)
+{
+    return copyString("Part " + std::to_string(nPart + 1));
+}
+
+char* documentGetPartHash(LibreOfficeKitDocument*, int nPart)
+{
+    return copyString(std::to_string(nPart));
+}
+
+void documentSetPartMode(LibreOfficeKitDocument*, int) {}
+
+/// @brief Color of document point in twips. Depends only on part and position,
+/// so tiles of any zoom match each other.
+void fakePixel(const FakeDocument& document, long x, long y, unsigned char* bgra)
+{
+    unsigned char b = 255, g = 255, r = 255, a = 255;
+    const int look = document.part % document.distinctParts;
+    if (x < 0 || y < 0 || x >= document.width || y >= document.height) {
+        //Outside of document.
+        b = g = r = a = 0;
+    }
+    else if (x > document.width / 10 && x < document.width / 2 && y > document.height / 5 && y < document.height / 3)
+    {
+        //Title block, color differs per part.
+        b = static_cast<unsigned char>(60 + look * 40);
+        g = static_cast<unsigned char>(90 + look * 70);
+        r = static_cast<unsigned char>(200 - look * 30);
+    }
+    else if (y > document.height / 2 && (y / 240) % 2 == 0 && x > document.width / 10 && x < document.width * 9 / 10
+        && ((x / 180) * 7 + (y / 480) * 3 + look) % 5 != 0)
+    {
+        //Lines of "words".
+        b = g = r = 40;
+    }
+    bgra[0] = b; bgra[1] = g; bgra[2] = r; bgra[3] = a;
+}
+
+void documentPaintTile(LibreOfficeKitDocument* pThis, unsigned char* pBuffer,
+                       const int nCanvasWidth, const int nCanvasHeight,
+                       const int nTilePosX, const int nTilePosY,
+                       const int nTileWidth, const int nTileHeight)
+{
+    auto document = asDocument(pThis);
+    auto start = nowMicroseconds();
+    sleepFor("LOKIT_FAKE_PAINT_MS");
+    for (int y = 0; y < nCanvasHeight; ++y)
+    {
+        long twipY = nTilePosY + static_cast<long>(static_cast<long long>(y) * nTileHeight / nCanvasHeight);
+        unsigned char* row = pBuffer + static_cast<size_t>(y) * nCanvasWidth * 4;
+        for (int x = 0; x < nCanvasWidth; ++x)
+        {
+            long twipX = nTilePosX + static_cast<long>(static_cast<long long>(x) * nTileWidth / nCanvasWidth);
+            fakePixel(*document, twipX, twipY, row + static_cast<size_t>(x) * 4);
+        }
+    }
+    document->office->addProfileZone("paintTile", start);
+}
+
+void documentPaintPartTile(LibreOfficeKitDocument* pThis, unsigned char* pBuffer, const int nPart, const int,
+                           const int nCanvasWidth, const int nCanvasHeight,
+                           const int nTilePosX, const int nTilePosY,
+                           const int nTileWidth, const int nTileHeight)
+{
+    auto document = asDocument(pThis);
+    int part = document->part;
+    document->part = nPart;
+    documentPaintTile(pThis, pBuffer, nCanvasWidth, nCanvasHeight, nTilePosX, nTilePosY, nTileWidth, nTileHeight);
+    document->part = part;
+}
+
+/// @brief Renders line of paragraph found in payload, paragraphs of the shape are rendered from its title block.
+bool documentRenderSearchResult(LibreOfficeKitDocument* pThis, const char* pSearchResult,
+                                unsigned char** pBitmapBuffer, int* pWidth, int* pHeight, size_t* pByteSize)
+{
+    auto document = asDocument(pThis);
+    std::string payload = pSearchResult ? pSearchResult : "";
+    const std::string indexAttribute = "index=\"";
+    auto indexPosition = payload.find(indexAttribute);
+    if (document->type != LOK_DOCTYPE_TEXT || indexPosition == std::string::npos) {
+        return false;
+    }
+    int index = std::atoi(payload.c_str() + indexPosition + indexAttribute.size());
+    long top = 0;
+    if (payload.find("node_type=\"common\"") != std::string::npos && index == 0) {
+        top = document->height / 5;
+    }
+    else if (payload.find("node_type=\"writer\"") != std::string::npos && index >= 0 && index < fakeParagraphCount) {
+        top = document->height / 2 + index * fakeParagraphPitch;
+    }
+    else {
+        return false;
+    }
+    //96 dpi.
+    constexpr long twipsPerPixel = 15;
+    const int width = static_cast<int>(document->width / twipsPerPixel);
+    const int height = static_cast<int>(fakeParagraphHeight / twipsPerPixel);
+    auto buffer = static_cast<unsigned char*>(std::malloc(static_cast<size_t>(width) * height * 4));
+    documentPaintTile(pThis, buffer, width, height, 0, top, document->width, fakeParagraphHeight);
+    *pBitmapBuffer = buffer;
+    *pWidth = width;
+    *pHeight = height;
+    *pByteSize = static_cast<size_t>(width) * height * 4;
+    return true;
+}
+
+int documentGetTileMode(LibreOfficeKitDocument*)
+{
+    return LOK_TILEMODE_BGRA;
+}
+
+void documentGetDocumentSize(LibreOfficeKitDocument* pThis, long* pWidth, long* pHeight)
+{
+    auto document = asDocument(pThis);
+    *pWidth = document->width;
+    *pHeight = document->height;
+}
+
+void documentInitializeForRendering(LibreOfficeKitDocument* pThis, const char*)
+{
+    auto document = asDocument(pThis);
+    if (document->callback)
+    {
+        std::string payload = "EMPTY";
+        if (document->office->features & LOK_FEATURE_PART_IN_INVALIDATION_CALLBACK) {
+            payload += ", " + std::to_string(document->part);
+        }
+        document->callback(LOK_CALLBACK_INVALIDATE_TILES, payload.c_str(), document->callbackData);
+    }
+}
+
+/// @brief Comma separated font families of LOKIT_FAKE_FONTS used by every document, which are not added as font files of the same name.
+std::string missingFontsPayload(const FakeOffice& office)
+{
+    const char* fonts = std::getenv("LOKIT_FAKE_FONTS");
+    std::string payload;
+    std::istringstream families(fonts ? fonts : "");
+    for (std::string family; std::getline(families, family, ',');)
+    {
+        std::string name = family;
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        if (family.empty() || std::find(office.addedFonts.begin(), office.addedFonts.end(), name) != office.addedFonts.end()) {
+            continue;
+        }
+        payload += (payload.empty() ? "" : ",") + std::string("\"") + family + "\"";
+    }
+    return payload.empty() ? payload : "{\"fontsmissing\":[" + payload + "]}";
+}
+
+void documentRegisterCallback(LibreOfficeKitDocument* pThis, LibreOfficeKitCallback pCallback, void* pData)
+{
+    auto document = asDocument(pThis);
+    document->callback = pCallback;
+    document->callbackData = pData;
+    //LibreOffice reports fonts missing in loaded document once its callback is registered.
+    std::string fontsMissing = missingFontsPayload(*document->office);
+    if (pCallback && !fontsMissing.empty()) {
+        pCallback(LOK_CALLBACK_FONTS_MISSING, fontsMissing.c_str(), pData);
+    }
+}
+
+void documentPostUnoCommand(LibreOfficeKitDocument* pThis, const char* pCommand, const char*, bool)
+{
+    if (std::strcmp(pCommand, ".uno:SelectAll") == 0) {
+        asDocument(pThis)->isAllSelected = true;
+    }
+}
+
+char* documentGetTextSelection(LibreOfficeKitDocument* pThis, const char*, char** pUsedMimeType)
+{
+    auto document = asDocument(pThis);
+    if (pUsedMimeType) {
+        *pUsedMimeType = copyString("text/plain;charset=utf-8");
+    }
+    if (!document->isAllSelected) {
+        return copyString("");
+    }
+    sleepFor("LOKIT_FAKE_TEXT_MS");
+    if (document->type != LOK_DOCTYPE_TEXT) {
+        return copyString("Text of part " + std::to_string(document->part + 1) + " of " + document->path + "\n");
+    }
+    std::string text;
+    for (int i = 0; i < document->parts; ++i) {
+        text += "Text of page " + std::to_string(i + 1) + " of " + document->path + "\n";
+    }
+    return copyString(text);
+}
+
+void documentResetSelection(LibreOfficeKitDocument* pThis)
+{
+    asDocument(pThis)->isAllSelected = false;
+}
+
+LibreOfficeKitDocumentClass* documentClass()
+{
+    static LibreOfficeKitDocumentClass documentClass = []() {
+        LibreOfficeKitDocumentClass result{};
+        result.nSize = sizeof(LibreOfficeKitDocumentClass);
+        result.destroy = documentDestroy;
+        result.saveAs = documentSaveAs;
+        result.getDocumentType = documentGetDocumentType;
+        result.getParts = documentGetParts;
+        result.getPart = documentGetPart;
+        result.setPart = documentSetPart;
+        result.getPartName = documentGetPartName;
+        result.getPartHash = documentGetPartHash;
+        result.setPartMode = documentSetPartMode;
+        result.paintTile = documentPaintTile;
+        result.paintPartTile = documentPaintPartTile;
+        result.getTileMode = documentGetTileMode;
+        result.getDocumentSize = documentGetDocumentSize;
+        result.initializeForRendering = documentInitializeForRendering;
+        result.registerCallback = documentRegisterCallback;
+        result.postUnoCommand = documentPostUnoCommand;
+        result.getTextSelection = documentGetTextSelection;
+        result.resetSelection = documentResetSelection;
+        result.renderSearchResult = documentRenderSearchResult;
+        return result;
+    }();
+    return &documentClass;
+}
+
+//Office
+
+void officeDestroy(LibreOfficeKit* pThis)
+{
+    auto office = asOffice(pThis);
+    if (office->thread != std::this_thread::get_id())
+    {
+        std::fprintf(stderr, "Office is destroyed on other thread than it was created on\n");
+        std::abort();
+    }
+    delete office;
+}
+
+LibreOfficeKitDocument* officeDocumentLoadWithOptions(LibreOfficeKit* pThis, const char* pURL, const char*)
+{
+    auto office = asOffice(pThis);
+    auto start = nowMicroseconds();
+    //Load progress is reported to office callback, since document does not exist yet.
+    office->notify(LOK_CALLBACK_STATUS_INDICATOR_START, "Loading document");
+    office->notify(LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE, "0");
+    sleepFor("LOKIT_FAKE_LOAD_MS");
+    office->notify(LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE, "100");
+    office->notify(LOK_CALLBACK_STATUS_INDICATOR_FINISH, "");
+    std::string path = urlToPath(pURL ? pURL : "");
+    const char* crash = std::getenv("LOKIT_FAKE_CRASH");
+    if (crash && *crash && path.find(crash) != std::string::npos) {
+        std::abort();
+    }
+    //Pathological document spinning till process is killed.
+    const char* hang = std::getenv("LOKIT_FAKE_HANG");
+    if (hang && *hang && path.find(hang) != std::string::npos) {
+        std::this_thread::sleep_for(std::chrono::hours(24));
+    }
+    if (!std::ifstream(path)) {
+        office->error = "Unsupported URL <" + std::string(pURL ? pURL : "") + ">: \"type detection failed\"";
+        office->notify(LOK_CALLBACK_ERROR, R"({"classification":"error","kind":"io","code":"0","message":"type detection failed"})");
+        return nullptr;
+    }
+    auto document = new FakeDocument();
+    document->pClass = documentClass();
+    document->office = office;
+    document->path = path;
+    document->type = documentTypeOf(extensionOf(path));
+    document->parts = document->type == LOK_DOCTYPE_TEXT
+        ? environmentInt("LOKIT_FAKE_TEXT_PAGES", 1) : environmentInt("LOKIT_FAKE_PARTS", 4);
+    document->distinctParts = std::max(1, environmentInt("LOKIT_FAKE_DISTINCT_PARTS", document->parts));
+    if (document->type == LOK_DOCTYPE_TEXT) {
+        //A4 page.
+        document->width = 11906;
+        document->height = 16838;
+    }
+    else {
+        //16:9 slide.
+        document->width = 28000;
+        document->height = 15750;
+    }
+    office->addProfileZone("documentLoad", start);
+    return document;
+}
+
+LibreOfficeKitDocument* officeDocumentLoad(LibreOfficeKit* pThis, const char* pURL)
+{
+    return officeDocumentLoadWithOptions(pThis, pURL, nullptr);
+}
+
+char* officeGetError(LibreOfficeKit* pThis)
+{
+    return copyString(asOffice(pThis)->error);
+}
+
+void officeFreeError(char* pFree)
+{
+    std::free(pFree);
+}
+
+void officeRegisterCallback(LibreOfficeKit* pThis, LibreOfficeKitCallback pCallback, void* pData)
+{
+    auto office = asOffice(pThis);
+    office->callback = pCallback;
+    office->callbackData = pData;
+}
+
+void officeSetOptionalFeatures(LibreOfficeKit* pThis, unsigned long long features)
+{
+    asOffice(pThis)->features = features;
+}
+
+char* officeGetFilterTypes(LibreOfficeKit*)
+{
+    //Subset of real types, enough for native formats, OOXML and pdf of every document type.
+    //Like LibreOffice, reports TypeDetection types with media type rather than filters.
+    return copyString(
+        "{\"writer8\":{\"MediaType\":\"application/vnd.oasis.opendocument.text\"},"
+        "\"writer_MS_Word_2007\":{\"MediaType\":\"application/vnd.openxmlformats-officedocument.wordprocessingml.document\"},"
+        "\"writer_Text\":{\"MediaType\":\"text/plain\"},"
+        "\"calc8\":{\"MediaType\":\"application/vnd.oasis.opendocument.spreadsheet\"},"
+        "\"MS Excel 2007 XML\":{\"MediaType\":\"application/vnd.openxmlformats-officedocument.spreadsheetml.sheet\"},"
+        "\"calc_MS_Excel_97\":{\"MediaType\":\"application/vnd.ms-excel\"},"
+        "\"impress8\":{\"MediaType\":\"application/vnd.oasis.opendocument.presentation\"},"
+        "\"MS PowerPoint 2007 XML\":{\"MediaType\":\"application/vnd.openxmlformats-officedocument.presentationml.presentation\"},"
+        "\"draw8\":{\"MediaType\":\"application/vnd.oasis.opendocument.graphics\"},"
+        "\"pdf_Portable_Document_Format\":{\"MediaType\":\"application/pdf\"},"
+        "\"png_Portable_Network_Graphic\":{\"MediaType\":\"image/png\"}}"
+    );
+}
+
+char* officeGetVersionInfo(LibreOfficeKit*)
+{
+    return copyString(R"({"ProductName":"LokitFakeOffice","ProductVersion":"0.1","ProductExtension":"","BuildId":"lokit-fake"})");
+}
+
+void officeSetOption(LibreOfficeKit* pThis, const char* pOption, const char* pValue)
+{
+    auto office = asOffice(pThis);
+    if (std::strcmp(pOption, "addfont") == 0)
+    {
+        std::string name = std::filesystem::path(urlToPath(pValue)).stem().string();
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        office->addedFonts.push_back(name);
+        //LibreOffice rebuilds font list on each added font.
+        sleepFor("LOKIT_FAKE_ADD_FONT_MS");
+    }
+    if (std::strcmp(pOption, "profilezonerecording") == 0)
+    {
+        if (std::strcmp(pValue, "start") == 0) {
+            office->recordingProfileZones = true;
+        }
+        else if (std::strcmp(pValue, "stop") == 0)
+        {
+            office->recordingProfileZones = false;
+            if (office->callback && !office->profileZones.empty()) {
+                office->callback(LOK_CALLBACK_PROFILE_FRAME, office->profileZones.c_str(), office->callbackData);
+            }
+            office->profileZones.clear();
+        }
+    }
+}
+
+void officeTrimMemory(LibreOfficeKit*, int) {}
+
+LibreOfficeKitClass* officeClass()
+{
+    static LibreOfficeKitClass officeClass = []() {
+        LibreOfficeKitClass result{};
+        result.nSize = sizeof(LibreOfficeKitClass);
+        result.destroy = officeDestroy;
+        result.documentLoad = officeDocumentLoad;
+        result.getError = officeGetError;
+        result.documentLoadWithOptions = officeDocumentLoadWithOptions;
+        result.freeError = officeFreeError;
+        result.registerCallback = officeRegisterCallback;
+        result.setOptionalFeatures = officeSetOptionalFeatures;
+        result.getFilterTypes = officeGetFilterTypes;
+        result.getVersionInfo = officeGetVersionInfo;
+        result.setOption = officeSetOption;
+        result.trimMemory = officeTrimMemory;
+        return result;
+    }();
+    return &officeClass;
+}
+
+}
+
+extern "C"
+{
+
+FAKE_LOK_EXPORT LibreOfficeKit* libreofficekit_hook_2(const char*, const char* user_profile_url)
+{
+    if (!isPreinited) {
+        sleepFor("LOKIT_FAKE_INIT_MS");
+    }
+    if (user_profile_url)
+    {
+        //Like LibreOffice, keeps settings in user subdirectory of profile and creates it on first start.
+        auto user = std::filesystem::path(urlToPath(user_profile_url)) / "user";
+        auto settings = user / "registrymodifications.xcu";
+        if (!std::filesystem::exists(settings))
+        {
+            sleepFor("LOKIT_FAKE_PROFILE_MS");
+            std::error_code error;
+            std::filesystem::create_directories(user, error);
+            std::ofstream(settings) << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<oor:items/>\n";
+        }
+    }
+    auto office = new FakeOffice();
+    office->pClass = officeClass();
+    return office;
+}
+
+FAKE_LOK_EXPORT LibreOfficeKit* libreofficekit_hook(const char* install_path)
+{
+    return libreofficekit_hook_2(install_path, nullptr);
+}
+
+FAKE_LOK_EXPORT int lok_preinit(const char*, const char*)
+{
+    sleepFor("LOKIT_FAKE_INIT_MS");
+    isPreinited = true;
+    return 0;
+}
+
+}
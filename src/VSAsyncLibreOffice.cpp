@@ -0,0 +1,114 @@
+#include "VSAsyncLibreOffice.h"
+
+#include <utility>
+
+VSAsyncLibreOffice::VSAsyncLibreOffice() : m_thread(&VSAsyncLibreOffice::work, this)
+{}
+
+VSAsyncLibreOffice::~VSAsyncLibreOffice()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_operationPosted.notify_one();
+    m_thread.join();
+}
+
+auto VSAsyncLibreOffice::init(const Path& pathToLibreOffice) -> std::future<std::optional<Error>>
+{
+    return submit([pathToLibreOffice](VSLibreOffice& libreOffice) {
+        return libreOffice.init(pathToLibreOffice);
+    });
+}
+
+std::future<void> VSAsyncLibreOffice::deinit()
+{
+    return submit([](VSLibreOffice& libreOffice) {
+        libreOffice.deinit();
+    });
+}
+
+auto VSAsyncLibreOffice::open(const Path& pathToFile) -> std::future<std::optional<Error>>
+{
+    return submit([pathToFile](VSLibreOffice& libreOffice) {
+        return libreOffice.open(pathToFile);
+    });
+}
+
+std::future<void> VSAsyncLibreOffice::close()
+{
+    return submit([](VSLibreOffice& libreOffice) {
+        libreOffice.close();
+    });
+}
+
+std::future<int> VSAsyncLibreOffice::partCount()
+{
+    return submit([](VSLibreOffice& libreOffice) {
+        return libreOffice.partCount();
+    });
+}
+
+std::future<std::vector<unsigned char>> VSAsyncLibreOffice::renderPart(int part, int pixelWidth, int pixelHeight)
+{
+    return submit([=](VSLibreOffice& libreOffice) {
+        libreOffice.setPart(part);
+        std::vector<unsigned char> buffer(static_cast<size_t>(pixelWidth) * pixelHeight * VSLibreOffice::bytesPerPixel);
+        libreOffice.renderPart(pixelWidth, pixelHeight, buffer.data());
+        return buffer;
+    });
+}
+
+std::future<std::optional<VSLibreOffice::Bitmap>> VSAsyncLibreOffice::renderSearchResult(const std::string& searchResult)
+{
+    return submit([searchResult](VSLibreOffice& libreOffice) {
+        return libreOffice.renderSearchResult(searchResult);
+    });
+}
+
+auto VSAsyncLibreOffice::saveAs(const Path& path, const std::string& format) -> std::future<std::optional<Error>>
+{
+    return submit([path, format](VSLibreOffice& libreOffice) {
+        return libreOffice.saveAs(path, format);
+    });
+}
+
+std::future<bool> VSAsyncLibreOffice::trimMemory(int target)
+{
+    return submit([target](VSLibreOffice& libreOffice) {
+        return libreOffice.trimMemory(target);
+    });
+}
+
+void VSAsyncLibreOffice::post(std::function<void()> operation)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_operations.push_back(std::move(operation));
+    }
+    m_operationPosted.notify_one();
+}
+
+void VSAsyncLibreOffice::work()
+{
+    std::unique_lock lock(m_mutex);
+    for (;;)
+    {
+        m_operationPosted.wait(lock, [this] { return m_stopping || !m_operations.empty(); });
+        if (m_operations.empty()) {
+            break;
+        }
+        //Operations submitted back to back are executed without waiting on condition.
+        auto operations = std::move(m_operations);
+        m_operations.clear();
+        lock.unlock();
+        for (auto& operation : operations) {
+            operation();
+        }
+        lock.lock();
+    }
+    lock.unlock();
+    //LibreOffice must be destroyed on the thread it was used from.
+    m_libreOffice.deinit();
+}
@@ -0,0 +1,83 @@
+#ifndef VS_ASYNC_LIBRE_OFFICE
+#define VS_ASYNC_LIBRE_OFFICE
+
+#include <future>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <type_traits>
+
+#include "VSLibreOffice.h"
+
+/// @brief Owns VSLibreOffice and executes operations on it in order of submission
+/// on dedicated thread, so callers are not blocked by LibreOffice.
+/// Results and exceptions are delivered through futures.
+/// Built into lokit_office library, which applications embedding LibreOffice link.
+class VSAsyncLibreOffice
+{
+public:
+    using Path = VSLibreOffice::Path;
+    using Error = VSLibreOffice::Error;
+
+    VSAsyncLibreOffice();
+    VSAsyncLibreOffice(const VSAsyncLibreOffice&) = delete;
+    VSAsyncLibreOffice& operator=(const VSAsyncLibreOffice&) = delete;
+    /// @brief Executes already submitted operations and deinitializes office.
+    ~VSAsyncLibreOffice();
+
+    /// @brief Submits function to be invoked with office on its thread.
+    /// Several calls done in one function cost single thread switch.
+    template<typename Function>
+    auto submit(Function function) -> std::future<std::invoke_result_t<Function, VSLibreOffice&>>;
+
+    /// @see VSLibreOffice::init
+    std::future<std::optional<Error>> init(const Path& pathToLibreOffice);
+    /// @see VSLibreOffice::deinit
+    std::future<void> deinit();
+    /// @see VSLibreOffice::open
+    std::future<std::optional<Error>> open(const Path& pathToFile);
+    /// @see VSLibreOffice::close
+    std::future<void> close();
+    /// @see VSLibreOffice::partCount
+    std::future<int> partCount();
+    /// @brief Sets part and renders it.
+    /// @see VSLibreOffice::renderPart
+    std::future<std::vector<unsigned char>> renderPart(int part, int pixelWidth, int pixelHeight);
+    /// @see VSLibreOffice::renderSearchResult
+    std::future<std::optional<VSLibreOffice::Bitmap>> renderSearchResult(const std::string& searchResult);
+    /// @see VSLibreOffice::saveAs
+    std::future<std::optional<Error>> saveAs(const Path& path, const std::string& format);
+    /// @see VSLibreOffice::trimMemory
+    std::future<bool> trimMemory(int target);
+
+private:
+    void post(std::function<void()> operation);
+    void work();
+
+    //Accessed only from m_thread.
+    VSLibreOffice m_libreOffice;
+
+    std::mutex m_mutex;
+    std::condition_variable m_operationPosted;
+    std::deque<std::function<void()>> m_operations;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+template<typename Function>
+auto VSAsyncLibreOffice::submit(Function function) -> std::future<std::invoke_result_t<Function, VSLibreOffice&>>
+{
+    using Result = std::invoke_result_t<Function, VSLibreOffice&>;
+    //std::function requires copyable target, while packaged_task is move only.
+    auto task = std::make_shared<std::packaged_task<Result()>>(
+        [this, function = std::move(function)]() mutable { return function(m_libreOffice); }
+    );
+    auto result = task->get_future();
+    post([task] { (*task)(); });
+    return result;
+}
+
+#endif //VS_ASYNC_LIBRE_OFFICE
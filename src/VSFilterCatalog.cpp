@@ -0,0 +1,152 @@
+#include "VSFilterCatalog.h"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+
+#include "VSFilterCatalogData.h"
+
+namespace
+{
+constexpr char toLower(char c)
+{
+    return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+constexpr bool equalsIgnoreCase(std::string_view left, std::string_view right)
+{
+    if (left.size() != right.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < left.size(); ++i)
+    {
+        if (toLower(left[i]) != toLower(right[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// @brief Case insensitive FNV-1a.
+constexpr std::uint64_t hash(std::string_view value)
+{
+    std::uint64_t result = 14695981039346656037ull;
+    for (char c : value)
+    {
+        result ^= static_cast<unsigned char>(toLower(c));
+        result *= 1099511628211ull;
+    }
+    return result;
+}
+
+constexpr size_t filterCount = std::size(filterCatalogData);
+
+//Open addressing table of filter indices, at most half full, so probe sequences stay short.
+constexpr size_t tableSize = [] {
+    size_t size = 1;
+    while (size < 2 * filterCount) {
+        size *= 2;
+    }
+    return size;
+}();
+using Slot = std::int16_t;
+static_assert(filterCount < 0x7FFF, "Filter indices must fit in slots");
+constexpr Slot emptySlot = -1;
+using Table = std::array<Slot, tableSize>;
+
+template<typename Key>
+constexpr Table makeTable(Key key)
+{
+    Table table{};
+    for (auto& slot : table) {
+        slot = emptySlot;
+    }
+    for (size_t i = 0; i < filterCount; ++i)
+    {
+        std::string_view value = key(filterCatalogData[i]);
+        if (value.empty()) {
+            continue;
+        }
+        size_t slot = hash(value) & (tableSize - 1);
+        while (table[slot] != emptySlot) {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        table[slot] = static_cast<Slot>(i);
+    }
+    return table;
+}
+
+constexpr Table nameTable = makeTable([](const VSFilterCatalog::Filter& filter) {
+    return std::string_view(filter.name);
+});
+//Filters sharing extension, e.g. pdf export of each document type, are all met before empty slot.
+constexpr Table extensionTable = makeTable([](const VSFilterCatalog::Filter& filter) {
+    return std::string_view(filter.extension);
+});
+constexpr Table fileTypeTable = makeTable([](const VSFilterCatalog::Filter& filter) {
+    return std::string_view(filter.fileType);
+});
+
+/// @brief Invokes function with filters whose key equals value till it returns true.
+template<typename Equals, typename Function>
+const VSFilterCatalog::Filter* probe(const Table& table, std::string_view value, Equals equals, Function function)
+{
+    for (size_t slot = hash(value) & (tableSize - 1); table[slot] != emptySlot; slot = (slot + 1) & (tableSize - 1))
+    {
+        const auto& filter = filterCatalogData[table[slot]];
+        if (equals(filter) && function(filter)) {
+            return &filter;
+        }
+    }
+    return nullptr;
+}
+}
+
+auto VSFilterCatalog::findByName(std::string_view name) -> const Filter*
+{
+    return probe(
+        nameTable, name,
+        [&](const Filter& filter) { return name == filter.name; },
+        [](const Filter&) { return true; }
+    );
+}
+
+auto VSFilterCatalog::findByExtension(DocumentTypes documentTypes, std::string_view extension) -> const Filter*
+{
+    return probe(
+        extensionTable, extension,
+        [&](const Filter& filter) { return equalsIgnoreCase(extension, filter.extension); },
+        [&](const Filter& filter) { return (filter.documentTypes & documentTypes) != 0; }
+    );
+}
+
+auto VSFilterCatalog::findByFileType(std::string_view fileType) -> const Filter*
+{
+    return probe(
+        fileTypeTable, fileType,
+        [&](const Filter& filter) { return fileType == filter.fileType; },
+        [](const Filter&) { return true; }
+    );
+}
+
+auto VSFilterCatalog::documentTypesOf(std::string_view extension) -> DocumentTypes
+{
+    DocumentTypes result = noDocumentTypes;
+    probe(
+        extensionTable, extension,
+        [&](const Filter& filter) { return equalsIgnoreCase(extension, filter.extension); },
+        [&](const Filter& filter) {
+            result |= filter.documentTypes;
+            return false;
+        }
+    );
+    return result;
+}
+
+auto VSFilterCatalog::resolve(std::string_view format, DocumentTypes documentTypes) -> const Filter*
+{
+    if (auto filter = findByName(format)) {
+        return (filter->documentTypes & documentTypes) != 0 ? filter : nullptr;
+    }
+    return findByExtension(documentTypes, format);
+}
@@ -0,0 +1,59 @@
+#ifndef VS_FILTER_CATALOG
+#define VS_FILTER_CATALOG
+
+#include <string_view>
+
+#define LOK_USE_UNSTABLE_API
+#include <LibreOfficeKit/LibreOfficeKitEnums.h>
+
+/// @brief LibreOffice filters known at build time, generated from types.txt and filter_formats.txt,
+/// so conversion can be validated before LibreOffice is initialized and document is loaded.
+class VSFilterCatalog
+{
+public:
+    /// @brief Bit set of document types, bits are numbered by LOK_DOCTYPE_* values.
+    using DocumentTypes = unsigned;
+    static constexpr DocumentTypes noDocumentTypes = 0;
+    static constexpr DocumentTypes text = 1u << LOK_DOCTYPE_TEXT;
+    static constexpr DocumentTypes spreadsheet = 1u << LOK_DOCTYPE_SPREADSHEET;
+    static constexpr DocumentTypes presentation = 1u << LOK_DOCTYPE_PRESENTATION;
+    static constexpr DocumentTypes drawing = 1u << LOK_DOCTYPE_DRAWING;
+    static constexpr DocumentTypes allDocumentTypes = text | spreadsheet | presentation | drawing;
+
+    /// @param documentType - one of LOK_DOCTYPE_* values.
+    static constexpr DocumentTypes documentTypes(int documentType) {
+        return 1u << documentType;
+    }
+
+    struct Filter
+    {
+        const char* name;
+        /// @brief Types of documents saveAs exports with filter, noDocumentTypes if it does not.
+        DocumentTypes documentTypes;
+        /// @brief Format passed to saveAs and extension of exported file, empty if saveAs does not export with filter.
+        const char* extension;
+        /// @brief TypeDetection type of exported file, e.g. pdf_Portable_Document_Format,
+        /// empty if LibreOffice does not report the type or saveAs does not export with filter.
+        const char* fileType;
+    };
+
+    /// @return nullptr if filter is unknown.
+    static const Filter* findByName(std::string_view name);
+    /// @brief Finds filter saveAs exports document of any of documentTypes to extension with.
+    /// Extension is case insensitive.
+    /// @return nullptr if there is no such filter.
+    static const Filter* findByExtension(DocumentTypes documentTypes, std::string_view extension);
+    /// @brief Finds filter saveAs exports any document type with to file of fileType.
+    /// @return nullptr if there is no such filter.
+    static const Filter* findByFileType(std::string_view fileType);
+    /// @brief Types of documents exported to extension, e.g. presentation and drawing for odg.
+    /// Serves as guess of type of document with extension before it is loaded.
+    static DocumentTypes documentTypesOf(std::string_view extension);
+
+    /// @brief Finds filter document of any of documentTypes is converted with,
+    /// format is either extension or name of filter.
+    /// @return nullptr if document can not be converted to format.
+    static const Filter* resolve(std::string_view format, DocumentTypes documentTypes);
+};
+
+#endif //VS_FILTER_CATALOG
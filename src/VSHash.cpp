@@ -0,0 +1,98 @@
+#include "VSHash.h"
+
+#include <cstring>
+
+namespace
+{
+constexpr uint64_t prime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t prime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t prime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t prime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t prime5 = 0x27D4EB2F165667C5ULL;
+
+inline uint64_t rotateLeft(uint64_t value, int bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+//Specification defines hash of little endian words.
+inline uint64_t read64(const unsigned char* data)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | data[i];
+    }
+    return value;
+#else
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+#endif
+}
+
+inline uint32_t read32(const unsigned char* data)
+{
+    return static_cast<uint32_t>(data[0]) | static_cast<uint32_t>(data[1]) << 8
+        | static_cast<uint32_t>(data[2]) << 16 | static_cast<uint32_t>(data[3]) << 24;
+}
+
+inline uint64_t round(uint64_t accumulator, uint64_t input)
+{
+    accumulator += input * prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator * prime1;
+}
+
+inline uint64_t mergeRound(uint64_t accumulator, uint64_t value)
+{
+    accumulator ^= round(0, value);
+    return accumulator * prime1 + prime4;
+}
+}
+
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t seed)
+{
+    const unsigned char* end = data + size;
+    uint64_t hash;
+    if (size >= 32)
+    {
+        uint64_t lanes[4] = {seed + prime1 + prime2, seed + prime2, seed, seed - prime1};
+        for (; end - data >= 32; data += 32)
+        {
+            for (int lane = 0; lane < 4; ++lane) {
+                lanes[lane] = round(lanes[lane], read64(data + lane * 8));
+            }
+        }
+        hash = rotateLeft(lanes[0], 1) + rotateLeft(lanes[1], 7) + rotateLeft(lanes[2], 12) + rotateLeft(lanes[3], 18);
+        for (uint64_t lane : lanes) {
+            hash = mergeRound(hash, lane);
+        }
+    }
+    else {
+        hash = seed + prime5;
+    }
+    hash += size;
+    for (; end - data >= 8; data += 8)
+    {
+        hash ^= round(0, read64(data));
+        hash = rotateLeft(hash, 27) * prime1 + prime4;
+    }
+    if (end - data >= 4)
+    {
+        hash ^= static_cast<uint64_t>(read32(data)) * prime1;
+        hash = rotateLeft(hash, 23) * prime2 + prime3;
+        data += 4;
+    }
+    for (; data < end; ++data)
+    {
+        hash ^= *data * prime5;
+        hash = rotateLeft(hash, 11) * prime1;
+    }
+    hash ^= hash >> 33;
+    hash *= prime2;
+    hash ^= hash >> 29;
+    hash *= prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
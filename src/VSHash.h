@@ -0,0 +1,11 @@
+#ifndef VS_HASH
+#define VS_HASH
+
+#include <cstddef>
+#include <cstdint>
+
+/// @brief XXH64 hash of bytes, processes 32 bytes per iteration in four independent lanes,
+/// so hashing render buffer costs a fraction of encoding it.
+uint64_t hashBytes(const unsigned char* data, size_t size, uint64_t seed = 0);
+
+#endif //VS_HASH
@@ -0,0 +1,526 @@
+#include "VSImageExporter.h"
+
+#include <cassert>
+#include <cmath>
+#include <cctype>
+#include <fstream>
+#include <algorithm>
+#include <numeric>
+#include <utility>
+#include <unordered_map>
+
+#include <QImage>
+#include <QBuffer>
+#include <QByteArray>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+#include "VSImageScaling.h"
+#include "VSPixelConversion.h"
+#include "VSHash.h"
+
+VSImageExporter::VSImageExporter(Settings settings, VSProfiler* profiler, VSMetrics* metrics, VSWatchdog* watchdog, FailureHandler failureHandler)
+    : m_settings(settings), m_profiler(profiler), m_metrics(metrics), m_watchdog(watchdog), m_failureHandler(std::move(failureHandler)),
+      m_threadPool(settings.encodeThreads)
+{
+    //While one part is encoded by each thread, next ones are already rendered.
+    m_maxInFlightParts = 2 * static_cast<size_t>(m_threadPool.threadCount());
+}
+
+void VSImageExporter::exportDocument(VSLibreOffice& libreOffice, const std::string& format, const std::vector<Resolution>& resolutions, const boost::filesystem::path& outputDir)
+{
+    assert(libreOffice.isOpened());
+    assert(!resolutions.empty());
+    int width = 0;
+    int height = 0;
+    for (const auto& resolution : resolutions)
+    {
+        width = std::max(width, resolution.width);
+        height = std::max(height, resolution.height);
+    }
+    const size_t imageBytes = static_cast<size_t>(width) * VSLibreOffice::bytesPerPixel * height;
+    //Supersampled part is rendered in separate image, which is released once reduced.
+    const int factor = m_settings.supersample;
+    const int renderWidth = width * factor;
+    const int renderHeight = height * factor;
+    const size_t rowBytes = static_cast<size_t>(renderWidth) * VSLibreOffice::bytesPerPixel;
+    const size_t supersampledBytes = factor > 1 ? rowBytes * renderHeight : 0;
+    //Each resolution is downscaled from the smallest bigger one, which is already done, since they are made in order of decreasing area.
+    std::vector<size_t> order(resolutions.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t left, size_t right) {
+        return static_cast<long long>(resolutions[left].width) * resolutions[left].height
+            > static_cast<long long>(resolutions[right].width) * resolutions[right].height;
+    });
+    size_t scaledBytes = 0;
+    for (const auto& resolution : resolutions)
+    {
+        if (resolution.width != width || resolution.height != height) {
+            scaledBytes += static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel * resolution.height;
+        }
+    }
+    auto outputNamesOf = [&](int part)
+    {
+        std::vector<std::string> names;
+        for (const auto& resolution : resolutions)
+        {
+            names.push_back(resolutions.size() == 1
+                ? std::to_string(part) + "." + format
+                : std::to_string(part) + "_" + std::to_string(resolution.width) + "x" + std::to_string(resolution.height) + "." + format
+            );
+        }
+        return names;
+    };
+    //Hash of render to first part rendered the same.
+    std::unordered_map<uint64_t, int> partsByHash;
+    //Duplicate part and part it duplicates.
+    std::vector<std::pair<int, int>> duplicates;
+    for (int i = 0; i < libreOffice.partCount(); ++i)
+    {
+        libreOffice.setPart(i);
+        std::vector<std::string> outputPaths;
+        for (const auto& name : outputNamesOf(i)) {
+            outputPaths.push_back(boost::filesystem::path(outputDir).append(name).generic_string());
+        }
+        //LibreOffice allocates its own device of rendered area size, so whole part render costs image twice.
+        int stripRows = renderHeight;
+        const size_t partBytes = imageBytes + scaledBytes;
+        const size_t heldBytes = partBytes + supersampledBytes;
+        if (m_settings.memoryBudget != 0 && heldBytes + rowBytes * renderHeight > m_settings.memoryBudget)
+        {
+            if (heldBytes + minStripRows * rowBytes > m_settings.memoryBudget) {
+                fail("memory", "Image " + outputPaths.front() + " does not fit in memory budget");
+                continue;
+            }
+            stripRows = static_cast<int>(std::min<size_t>(renderHeight, (m_settings.memoryBudget - heldBytes) / rowBytes));
+            //Alignment is given up rather than making strip thinner than minStripRows.
+            if (int alignedRows = stripRows - stripRows % libreOffice.partRowsAlignment(renderHeight); alignedRows >= minStripRows) {
+                stripRows = alignedRows;
+            }
+        }
+        const size_t renderBytes = stripRows * rowBytes;
+        acquire(heldBytes + renderBytes);
+
+        QImage image(renderWidth, renderHeight, QImage::Format::Format_ARGB32_Premultiplied);
+        if (image.isNull())
+        {
+            release(heldBytes + renderBytes, true);
+            fail("memory", "Unable to allocate image " + outputPaths.front());
+            continue;
+        }
+        //32 bit lines are never padded, so image is laid out as LibreOffice renders it.
+        assert(static_cast<size_t>(image.bytesPerLine()) == rowBytes);
+        {
+            VSWatchdog::Scope watch(m_watchdog, "render", m_settings.renderTimeout, i);
+            if (stripRows == renderHeight) {
+                libreOffice.renderPart(renderWidth, renderHeight, image.bits());
+            }
+            else
+            {
+                for (int row = 0; row < renderHeight; row += stripRows) {
+                    libreOffice.renderPartRows(renderWidth, renderHeight, row, std::min(stripRows, renderHeight - row), image.scanLine(row));
+                }
+            }
+        }
+        release(renderBytes, false);
+        if (factor > 1)
+        {
+            image = reduceSupersampled(i, image, width, height);
+            release(supersampledBytes, false);
+            if (image.isNull())
+            {
+                release(partBytes, true);
+                fail("memory", "Unable to allocate image " + outputPaths.front());
+                continue;
+            }
+        }
+        if (m_settings.deduplication != Deduplication::none)
+        {
+            uint64_t hash = 0;
+            {
+                VSProfiler::Scope scope(m_profiler, "hash", i);
+                hash = hashBytes(image.constBits(), static_cast<size_t>(image.bytesPerLine()) * image.height());
+            }
+            if (auto [found, isNew] = partsByHash.try_emplace(hash, i); !isNew)
+            {
+                duplicates.emplace_back(i, found->second);
+                image = QImage();
+                release(partBytes, true);
+                continue;
+            }
+        }
+
+        m_threadPool.post([this, i, image = std::move(image), format, outputPaths = std::move(outputPaths), resolutions, order, partBytes]() mutable
+        {
+            std::vector<QImage> images(resolutions.size());
+            {
+                VSProfiler::Scope scope(m_profiler, "downscale", i);
+                for (size_t index : order)
+                {
+                    const auto& resolution = resolutions[index];
+                    if (resolution.width == image.width() && resolution.height == image.height()) {
+                        continue;
+                    }
+                    const QImage* source = &image;
+                    for (const auto& scaled : images)
+                    {
+                        bool isBigger = !scaled.isNull() && scaled.width() >= resolution.width && scaled.height() >= resolution.height;
+                        if (isBigger && static_cast<long long>(scaled.width()) * scaled.height() < static_cast<long long>(source->width()) * source->height()) {
+                            source = &scaled;
+                        }
+                    }
+                    images[index] = QImage(resolution.width, resolution.height, QImage::Format::Format_ARGB32_Premultiplied);
+                    if (images[index].isNull()) {
+                        continue;
+                    }
+                    downscaleArea(
+                        source->constBits(), source->width(), source->height(), source->bytesPerLine(),
+                        images[index].bits(), resolution.width, resolution.height, images[index].bytesPerLine()
+                    );
+                }
+            }
+            size_t heldBytes = partBytes;
+            auto releaseImage = [&](const Resolution& resolution)
+            {
+                size_t bytes = static_cast<size_t>(resolution.width) * VSLibreOffice::bytesPerPixel * resolution.height;
+                heldBytes -= bytes;
+                release(bytes, heldBytes == 0);
+            };
+            const Resolution rendered{image.width(), image.height()};
+            bool isRenderedExported = false;
+            for (size_t index = 0; index < images.size(); ++index)
+            {
+                bool isRendered = resolutions[index].width == rendered.width && resolutions[index].height == rendered.height;
+                if (!isRendered && images[index].isNull())
+                {
+                    releaseImage(resolutions[index]);
+                    fail("memory", "Unable to allocate image " + outputPaths[index]);
+                    continue;
+                }
+                isRenderedExported = isRenderedExported || isRendered;
+                auto encoded = encodeImage(i, isRendered ? std::move(image) : std::move(images[index]), format, outputPaths[index]);
+                releaseImage(resolutions[index]);
+                if (encoded) {
+                    writeImage(i, *encoded, outputPaths[index]);
+                }
+            }
+            if (!isRenderedExported)
+            {
+                image = QImage();
+                releaseImage(rendered);
+            }
+        });
+    }
+    m_threadPool.wait();
+    if (!duplicates.empty()) {
+        storeDuplicates(duplicates, outputNamesOf, outputDir);
+    }
+}
+
+void VSImageExporter::storeDuplicates(
+    const std::vector<std::pair<int, int>>& duplicates,
+    const std::function<std::vector<std::string>(int part)>& outputNamesOf,
+    const boost::filesystem::path& outputDir
+)
+{
+    namespace bfs = boost::filesystem;
+    boost::property_tree::ptree manifest;
+    for (const auto& [part, originalPart] : duplicates)
+    {
+        if (m_metrics) {
+            m_metrics->partDeduplicated();
+        }
+        auto names = outputNamesOf(part);
+        auto originalNames = outputNamesOf(originalPart);
+        for (size_t i = 0; i < names.size(); ++i)
+        {
+            bfs::path path = outputDir / names[i];
+            bfs::path originalPath = outputDir / originalNames[i];
+            boost::system::error_code error;
+            //Original failed to be encoded or written, duplicate has nothing to refer to.
+            if (!bfs::exists(originalPath, error))
+            {
+                fail("write", "Unable to store " + path.generic_string() + " as duplicate of missing " + originalPath.generic_string());
+                continue;
+            }
+            if (m_settings.deduplication == Deduplication::manifest)
+            {
+                //Names are not used as paths, since they contain dots.
+                manifest.push_back({names[i], boost::property_tree::ptree(originalNames[i])});
+                continue;
+            }
+            bfs::remove(path, error);
+            bfs::create_hard_link(originalPath, path, error);
+            //File systems without hard links get copy.
+            if (error) {
+                bfs::copy_file(originalPath, path, bfs::copy_option::overwrite_if_exists, error);
+            }
+            if (error) {
+                fail("write", "Unable to link " + path.generic_string() + " to " + originalPath.generic_string());
+            }
+        }
+    }
+    if (m_settings.deduplication == Deduplication::manifest)
+    {
+        auto manifestPath = outputDir / "duplicates.json";
+        std::ofstream file(manifestPath.string());
+        try {
+            boost::property_tree::write_json(file, manifest);
+        }
+        catch (const boost::property_tree::ptree_error&) {
+            file.setstate(std::ios::failbit);
+        }
+        if (!file) {
+            fail("write", "Unable to save " + manifestPath.generic_string());
+        }
+    }
+}
+
+void VSImageExporter::exportTiles(VSLibreOffice& libreOffice, const std::string& format, const TilePyramid& pyramid, const boost::filesystem::path& outputDir)
+{
+    assert(libreOffice.isOpened());
+    assert(pyramid.dpi > 0 && pyramid.tileSize > 0);
+    constexpr double twipsPerInch = 1440;
+    const size_t maxTileBytes = static_cast<size_t>(pyramid.tileSize) * pyramid.tileSize * VSLibreOffice::bytesPerPixel;
+    for (int i = 0; i < libreOffice.partCount(); ++i)
+    {
+        libreOffice.setPart(i);
+        auto partSize = libreOffice.partSize();
+        int width = std::max(1, static_cast<int>(std::lround(partSize.width * pyramid.dpi / twipsPerInch)));
+        int height = std::max(1, static_cast<int>(std::lround(partSize.height * pyramid.dpi / twipsPerInch)));
+        auto descriptorPath = boost::filesystem::path(outputDir) / (std::to_string(i) + ".dzi");
+        //LibreOffice allocates its own device of tile size, so tile render costs tile twice.
+        if (m_settings.memoryBudget != 0 && 2 * maxTileBytes > m_settings.memoryBudget) {
+            fail("memory", "Tiles of " + descriptorPath.generic_string() + " do not fit in memory budget");
+            continue;
+        }
+        {
+            std::ofstream descriptor(descriptorPath.string());
+            descriptor << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       << "<Image xmlns=\"http://schemas.microsoft.com/deepzoom/2008\" Format=\"" << format
+                       << "\" Overlap=\"0\" TileSize=\"" << pyramid.tileSize << "\">\n"
+                       << "  <Size Width=\"" << width << "\" Height=\"" << height << "\"/>\n"
+                       << "</Image>\n";
+            if (!descriptor) {
+                fail("write", "Unable to save " + descriptorPath.generic_string());
+                continue;
+            }
+        }
+        //Level 0 is single pixel, level maxLevel is full size.
+        int maxLevel = 0;
+        while ((1 << maxLevel) < std::max(width, height)) {
+            ++maxLevel;
+        }
+        for (int level = maxLevel; level >= 0; --level)
+        {
+            const int scale = 1 << (maxLevel - level);
+            const int levelWidth = (width + scale - 1) / scale;
+            const int levelHeight = (height + scale - 1) / scale;
+            auto levelDir = boost::filesystem::path(outputDir) / (std::to_string(i) + "_files") / std::to_string(level);
+            boost::system::error_code error;
+            if (!boost::filesystem::create_directories(levelDir, error) && error) {
+                fail("write", "Unable to create directory " + levelDir.generic_string());
+                break;
+            }
+            for (int top = 0; top < levelHeight; top += pyramid.tileSize)
+            {
+                for (int left = 0; left < levelWidth; left += pyramid.tileSize)
+                {
+                    const int tileWidth = std::min(pyramid.tileSize, levelWidth - left);
+                    const int tileHeight = std::min(pyramid.tileSize, levelHeight - top);
+                    const size_t tileBytes = static_cast<size_t>(tileWidth) * tileHeight * VSLibreOffice::bytesPerPixel;
+                    std::string outputPath = (levelDir / (
+                        std::to_string(left / pyramid.tileSize) + "_" + std::to_string(top / pyramid.tileSize) + "." + format
+                    )).generic_string();
+                    acquire(2 * tileBytes);
+                    QImage image(tileWidth, tileHeight, QImage::Format::Format_ARGB32_Premultiplied);
+                    if (image.isNull())
+                    {
+                        release(2 * tileBytes, true);
+                        fail("memory", "Unable to allocate image " + outputPath);
+                        continue;
+                    }
+                    assert(static_cast<size_t>(image.bytesPerLine()) == static_cast<size_t>(tileWidth) * VSLibreOffice::bytesPerPixel);
+                    {
+                        VSWatchdog::Scope watch(m_watchdog, "render", m_settings.renderTimeout, i);
+                        libreOffice.renderPartArea(levelWidth, levelHeight, left, top, tileWidth, tileHeight, image.bits());
+                    }
+                    release(tileBytes, false);
+                    m_threadPool.post([this, i, image = std::move(image), format, outputPath = std::move(outputPath), tileBytes]() mutable
+                    {
+                        auto encoded = encodeImage(i, std::move(image), format, outputPath);
+                        release(tileBytes, true);
+                        if (encoded) {
+                            writeImage(i, *encoded, outputPath);
+                        }
+                    });
+                }
+            }
+        }
+    }
+    m_threadPool.wait();
+}
+
+QImage VSImageExporter::reduceSupersampled(int part, const QImage& image, int width, int height)
+{
+    VSProfiler::Scope scope(m_profiler, "supersample", part);
+    QImage reduced(width, height, QImage::Format::Format_ARGB32_Premultiplied);
+    if (reduced.isNull()) {
+        return reduced;
+    }
+    //Bands of rows are reduced by all threads of pool, calling thread only waits.
+    const unsigned char* source = image.constBits();
+    unsigned char* target = reduced.bits();
+    const int bands = std::min(height, static_cast<int>(m_threadPool.threadCount()));
+    std::mutex bandsMutex;
+    std::condition_variable bandReduced;
+    int remainingBands = bands;
+    for (int band = 0; band < bands; ++band)
+    {
+        int firstRow = height * band / bands;
+        int rowCount = height * (band + 1) / bands - firstRow;
+        m_threadPool.post([&, firstRow, rowCount]
+        {
+            downscaleAreaRows(
+                source, image.width(), image.height(), image.bytesPerLine(),
+                target, width, height, reduced.bytesPerLine(), firstRow, rowCount
+            );
+            {
+                std::lock_guard lock(bandsMutex);
+                --remainingBands;
+            }
+            bandReduced.notify_one();
+        });
+    }
+    std::unique_lock lock(bandsMutex);
+    bandReduced.wait(lock, [&] {
+        return remainingBands == 0;
+    });
+    return reduced;
+}
+
+bool VSImageExporter::exportBitmap(VSLibreOffice::Bitmap bitmap, const std::string& format, const std::string& outputPath)
+{
+    //Pixels are converted in place, image only refers to them.
+    QImage image(
+        bitmap.pixels.data(), bitmap.width, bitmap.height, bitmap.width * VSLibreOffice::bytesPerPixel,
+        QImage::Format::Format_ARGB32_Premultiplied
+    );
+    auto encoded = encodeImage(VSProfiler::noPart, std::move(image), format, outputPath);
+    if (!encoded) {
+        return false;
+    }
+    return writeImage(VSProfiler::noPart, *encoded, outputPath);
+}
+
+bool VSImageExporter::isOpaqueFormat(const std::string& format)
+{
+    std::string lowerFormat = format;
+    std::transform(lowerFormat.begin(), lowerFormat.end(), lowerFormat.begin(), [](unsigned char c) {
+        return static_cast<char>(std::tolower(c));
+    });
+    for (const char* opaqueFormat : {"jpg", "jpeg", "bmp", "ppm"})
+    {
+        if (lowerFormat == opaqueFormat) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::optional<QByteArray> VSImageExporter::encodeImage(int part, QImage image, const std::string& format, const std::string& outputPath)
+{
+    //Refers to pixels of image if they are flattened.
+    QImage flattened;
+    {
+        VSProfiler::Scope scope(m_profiler, "pixelConversion", part);
+        //Flattened lines are shorter than ARGB32 ones, so image is flattened in place.
+        unsigned char* pixels = image.bits();
+        const uint32_t background = m_settings.background.value_or(0xFFFFFF);
+        const int rgbStride = (image.width() * 3 + 3) / 4 * 4;
+        const int indexStride = (image.width() + 3) / 4 * 4;
+        if (m_settings.pixelFormat == PixelFormat::gray8)
+        {
+            compositeOverGray(pixels, image.width(), image.height(), image.bytesPerLine(), background, pixels, indexStride);
+            flattened = QImage(pixels, image.width(), image.height(), indexStride, QImage::Format::Format_Grayscale8);
+        }
+        else if (m_settings.pixelFormat == PixelFormat::indexed8)
+        {
+            compositeOver(pixels, image.width(), image.height(), image.bytesPerLine(), background, pixels, rgbStride);
+            auto palette = quantizePopularity(pixels, image.width(), image.height(), rgbStride, pixels, indexStride);
+            flattened = QImage(pixels, image.width(), image.height(), indexStride, QImage::Format::Format_Indexed8);
+            flattened.setColorTable(QVector<QRgb>(palette.begin(), palette.end()));
+        }
+        else if (m_settings.background || isOpaqueFormat(format))
+        {
+            compositeOver(pixels, image.width(), image.height(), image.bytesPerLine(), background, pixels, rgbStride);
+            flattened = QImage(pixels, image.width(), image.height(), rgbStride, QImage::Format::Format_RGB888);
+        }
+        else {
+            //LibreOffice renders premultiplied alpha, image is converted in place.
+            image = std::move(image).convertToFormat(QImage::Format::Format_ARGB32);
+        }
+    }
+    QByteArray encoded;
+    bool isEncoded = false;
+    {
+        VSProfiler::Scope scope(m_profiler, "encode", part);
+        QBuffer encodedBuffer(&encoded);
+        encodedBuffer.open(QIODevice::WriteOnly);
+        isEncoded = (flattened.isNull() ? image : flattened).save(&encodedBuffer, format.c_str());
+    }
+    if (!isEncoded) {
+        fail("encode", "Unable to encode " + outputPath);
+        return std::nullopt;
+    }
+    return encoded;
+}
+
+bool VSImageExporter::writeImage(int part, const QByteArray& encoded, const std::string& outputPath)
+{
+    bool isWritten = false;
+    {
+        VSProfiler::Scope scope(m_profiler, "fileWrite", part);
+        std::ofstream file(outputPath, std::ios::binary);
+        isWritten = static_cast<bool>(file.write(encoded.constData(), encoded.size()));
+    }
+    if (!isWritten) {
+        fail("write", "Unable to save " + outputPath);
+    }
+    else if (m_metrics) {
+        m_metrics->bytesWritten(encoded.size());
+    }
+    return isWritten;
+}
+
+void VSImageExporter::acquire(size_t bytes)
+{
+    std::unique_lock lock(m_memoryMutex);
+    m_memoryReleased.wait(lock, [&] {
+        bool fitsBudget = m_settings.memoryBudget == 0 || m_inFlightBytes + bytes <= m_settings.memoryBudget;
+        return m_inFlightParts < m_maxInFlightParts && fitsBudget;
+    });
+    m_inFlightBytes += bytes;
+    ++m_inFlightParts;
+}
+
+void VSImageExporter::release(size_t bytes, bool isPartDone)
+{
+    {
+        std::lock_guard lock(m_memoryMutex);
+        assert(m_inFlightBytes >= bytes);
+        m_inFlightBytes -= bytes;
+        if (isPartDone) {
+            --m_inFlightParts;
+        }
+    }
+    m_memoryReleased.notify_all();
+}
+
+void VSImageExporter::fail(const std::string& cause, const std::string& message)
+{
+    std::lock_guard lock(m_failureMutex);
+    m_failureHandler(cause, message);
+}
@@ -0,0 +1,155 @@
+#ifndef VS_IMAGE_EXPORTER
+#define VS_IMAGE_EXPORTER
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include <boost/filesystem/path.hpp>
+
+#include <QImage>
+#include <QByteArray>
+
+#include "VSLibreOffice.h"
+#include "VSMetrics.h"
+#include "VSThreadPool.h"
+#include "VSWatchdog.h"
+
+/// @brief Exports document parts as images. Parts are rendered one by one on calling thread,
+/// while previously rendered parts are converted, encoded and written by thread pool.
+/// Memory of render buffers in flight is limited by budget shared by all exported documents.
+/// Several resolutions of part are rendered once, smaller ones are downscaled from bigger.
+class VSImageExporter
+{
+public:
+    struct Resolution
+    {
+        int width;
+        int height;
+    };
+
+    enum class PixelFormat
+    {
+        /// @brief Alpha is kept unless image is composited over background.
+        argb32,
+        /// @brief Luminance of image composited over background.
+        gray8,
+        /// @brief Image composited over background, reduced to 256 colors palette.
+        indexed8
+    };
+
+    enum class Deduplication
+    {
+        none,
+        /// @brief Images of part rendered the same as previous one are hard links to its images.
+        link,
+        /// @brief Images of such part are not written, outputDir/duplicates.json maps their names to names of existing ones.
+        manifest
+    };
+
+    struct Settings
+    {
+        /// @brief Limit of bytes held by render buffers in flight, 0 is unlimited.
+        size_t memoryBudget = 0;
+        /// @brief Count of threads encoding images, 0 is hardware concurrency.
+        unsigned encodeThreads = 0;
+        /// @brief Images are rendered at supersample times their resolution and reduced by area averaging,
+        /// which antialiases text and thin lines of small images.
+        int supersample = 1;
+        /// @brief Color 0xRRGGBB images are composited over, so they are encoded without alpha.
+        /// If not set, only images of formats without alpha are composited over white.
+        std::optional<uint32_t> background;
+        PixelFormat pixelFormat = PixelFormat::argb32;
+        /// @brief Parts of document are compared by hash of their renders, duplicates are not encoded.
+        Deduplication deduplication = Deduplication::none;
+        /// @brief Limit of rendering of one image by LibreOffice: part, including all its strips, or tile.
+        /// Watched only if exporter has watchdog.
+        std::optional<std::chrono::milliseconds> renderTimeout;
+    };
+
+    /// @brief Deep Zoom pyramid: the deepest level is part at dpi, each upper one halves previous.
+    struct TilePyramid
+    {
+        double dpi = 300;
+        int tileSize = 256;
+    };
+
+    /// @brief Invoked on failure to export part with failure cause and message.
+    /// Calls are serialized, but may come from thread pool.
+    using FailureHandler = std::function<void(const std::string& cause, const std::string& message)>;
+
+    /// @param profiler, metrics, watchdog - may be null, otherwise must outlive exporter.
+    VSImageExporter(Settings settings, VSProfiler* profiler, VSMetrics* metrics, VSWatchdog* watchdog, FailureHandler failureHandler);
+    VSImageExporter(const VSImageExporter&) = delete;
+    VSImageExporter& operator=(const VSImageExporter&) = delete;
+
+    /// @brief Exports each part to outputDir/<part>.<format> and waits till all of them are written.
+    /// If there are several resolutions, part is rendered at the largest width and height and exported
+    /// in each resolution to outputDir/<part>_<width>x<height>.<format>.
+    /// Part which does not fit in memory budget together with its render is rendered by strips,
+    /// part which does not fit in budget alone is reported as failure.
+    /// @pre libreOffice is opened, resolutions are not empty and distinct
+    void exportDocument(VSLibreOffice& libreOffice, const std::string& format, const std::vector<Resolution>& resolutions, const boost::filesystem::path& outputDir);
+
+    /// @brief Exports each part as Deep Zoom image, outputDir/<part>.dzi descriptor
+    /// and outputDir/<part>_files/<level>/<column>_<row>.<format> tiles, and waits till all of them are written.
+    /// Each tile is rendered directly from document at its level, so no level is rendered as a whole.
+    /// @pre libreOffice is opened, pyramid dpi and tile size are positive
+    void exportTiles(VSLibreOffice& libreOffice, const std::string& format, const TilePyramid& pyramid, const boost::filesystem::path& outputDir);
+
+    /// @brief Encodes image rendered by LibreOffice outside of document parts, e.g. search result,
+    /// and writes it to outputPath on calling thread. Failure is reported.
+    /// @return true if image is written.
+    bool exportBitmap(VSLibreOffice::Bitmap bitmap, const std::string& format, const std::string& outputPath);
+
+private:
+    /// @brief Minimal count of rows rendered at once, thinner strips make rendering too slow.
+    static constexpr int minStripRows = 16;
+
+    /// @brief Links or lists images of duplicate parts once images of parts they duplicate are written.
+    /// Duplicate of image, which is not written, is reported as write failure and is neither linked nor listed.
+    void storeDuplicates(
+        const std::vector<std::pair<int, int>>& duplicates,
+        const std::function<std::vector<std::string>(int part)>& outputNamesOf,
+        const boost::filesystem::path& outputDir
+    );
+    /// @brief Reduces supersampled image by bands of rows in thread pool.
+    /// @return null image if reduced one could not be allocated.
+    QImage reduceSupersampled(int part, const QImage& image, int width, int height);
+    /// @return true if format can not store alpha.
+    static bool isOpaqueFormat(const std::string& format);
+    /// @brief Converts rendered image to not premultiplied alpha or flattens it over background
+    /// and encodes it, failure is reported.
+    std::optional<QByteArray> encodeImage(int part, QImage image, const std::string& format, const std::string& outputPath);
+    /// @return true if image is written, otherwise failure is reported.
+    bool writeImage(int part, const QByteArray& encoded, const std::string& outputPath);
+    /// @brief Blocks till bytes of new part fit in budget and count of parts in flight is below limit.
+    void acquire(size_t bytes);
+    /// @param isPartDone - true if bytes are the last held by part.
+    void release(size_t bytes, bool isPartDone);
+    void fail(const std::string& cause, const std::string& message);
+
+    Settings m_settings;
+    VSProfiler* m_profiler;
+    VSMetrics* m_metrics;
+    VSWatchdog* m_watchdog;
+    FailureHandler m_failureHandler;
+    std::mutex m_failureMutex;
+
+    std::mutex m_memoryMutex;
+    std::condition_variable m_memoryReleased;
+    size_t m_inFlightBytes = 0;
+    size_t m_inFlightParts = 0;
+    /// @brief Limits parts waiting for encoding when budget is unlimited or big.
+    size_t m_maxInFlightParts;
+
+    //Destroyed first, so tasks do not outlive members they use.
+    VSThreadPool m_threadPool;
+};
+
+#endif //VS_IMAGE_EXPORTER
@@ -0,0 +1,127 @@
+#include "VSImageScaling.h"
+
+#include <cassert>
+#include <vector>
+#include <algorithm>
+
+namespace
+{
+constexpr int channels = 4;
+
+/// @brief Source pixels covered by target pixel along one axis.
+struct Coverage
+{
+    int first = 0;
+    /// @brief Covered fractions of source pixels starting from first, divided by scale, so they sum to 1.
+    std::vector<float> weights;
+};
+
+std::vector<Coverage> coverages(int sourceSize, int targetSize)
+{
+    //Coordinates are multiplied by both sizes, so bounds of all pixels are integer.
+    const long long sourceUnit = targetSize;
+    const long long targetUnit = sourceSize;
+    std::vector<Coverage> result(targetSize);
+    for (int t = 0; t < targetSize; ++t)
+    {
+        long long begin = t * targetUnit;
+        long long end = begin + targetUnit;
+        auto& coverage = result[t];
+        coverage.first = static_cast<int>(begin / sourceUnit);
+        int last = static_cast<int>((end - 1) / sourceUnit);
+        for (int s = coverage.first; s <= last; ++s)
+        {
+            long long overlap = std::min(end, (s + 1) * sourceUnit) - std::max(begin, s * sourceUnit);
+            coverage.weights.push_back(static_cast<float>(overlap) / targetUnit);
+        }
+    }
+    return result;
+}
+
+/// @brief Coverages of target pixels padded with zero weights to the widest one,
+/// so loop over weights of every pixel has the same trip count and reads contiguous table.
+struct PaddedCoverages
+{
+    int footprint = 0;
+    std::vector<int> first;
+    /// @brief footprint weights of each target pixel in order of pixels, each repeated for every channel,
+    /// so they are multiplied by covered values without shuffles.
+    std::vector<float> weights;
+};
+
+PaddedCoverages paddedCoverages(int sourceSize, int targetSize)
+{
+    const auto unpadded = coverages(sourceSize, targetSize);
+    PaddedCoverages result;
+    for (const auto& coverage : unpadded) {
+        result.footprint = std::max(result.footprint, static_cast<int>(coverage.weights.size()));
+    }
+    result.first.resize(targetSize);
+    const size_t pixelWeights = static_cast<size_t>(result.footprint) * channels;
+    result.weights.resize(targetSize * pixelWeights);
+    for (int t = 0; t < targetSize; ++t)
+    {
+        result.first[t] = unpadded[t].first;
+        for (size_t i = 0; i < unpadded[t].weights.size(); ++i) {
+            std::fill_n(result.weights.begin() + t * pixelWeights + i * channels, channels, unpadded[t].weights[i]);
+        }
+    }
+    return result;
+}
+}
+
+void downscaleArea(
+    const unsigned char* source, int sourceWidth, int sourceHeight, size_t sourceStride,
+    unsigned char* target, int targetWidth, int targetHeight, size_t targetStride
+)
+{
+    downscaleAreaRows(source, sourceWidth, sourceHeight, sourceStride, target, targetWidth, targetHeight, targetStride, 0, targetHeight);
+}
+
+void downscaleAreaRows(
+    const unsigned char* source, int sourceWidth, int sourceHeight, size_t sourceStride,
+    unsigned char* target, int targetWidth, int targetHeight, size_t targetStride,
+    int firstRow, int rowCount
+)
+{
+    assert(0 < targetWidth && targetWidth <= sourceWidth);
+    assert(0 < targetHeight && targetHeight <= sourceHeight);
+    assert(0 <= firstRow && 0 < rowCount && firstRow + rowCount <= targetHeight);
+    const auto columns = paddedCoverages(sourceWidth, targetWidth);
+    const auto rows = coverages(sourceHeight, targetHeight);
+    const size_t rowValues = static_cast<size_t>(sourceWidth) * channels;
+    //Padding weights of last columns reach past the row, they are multiplied by zeros kept after it.
+    std::vector<float> rowSums(rowValues + static_cast<size_t>(columns.footprint) * channels);
+    for (int y = firstRow; y < firstRow + rowCount; ++y)
+    {
+        //Vertical pass sums whole source rows, so it touches memory sequentially.
+        std::fill(rowSums.begin(), rowSums.begin() + rowValues, 0.0f);
+        float* sums = rowSums.data();
+        for (size_t i = 0; i < rows[y].weights.size(); ++i)
+        {
+            const unsigned char* sourceRow = source + (rows[y].first + i) * sourceStride;
+            const float weight = rows[y].weights[i];
+            for (size_t value = 0; value < rowValues; ++value) {
+                sums[value] += weight * sourceRow[value];
+            }
+        }
+        unsigned char* targetRow = target + y * targetStride;
+        //Horizontal pass multiplies covered values by weights of the same layout, every pixel takes the same steps.
+        const size_t pixelValues = static_cast<size_t>(columns.footprint) * channels;
+        for (int x = 0; x < targetWidth; ++x)
+        {
+            float pixel[channels] = {};
+            const float* covered = sums + static_cast<size_t>(columns.first[x]) * channels;
+            const float* weights = columns.weights.data() + x * pixelValues;
+            for (size_t value = 0; value < pixelValues; value += channels)
+            {
+                for (int channel = 0; channel < channels; ++channel) {
+                    pixel[channel] += weights[value + channel] * covered[value + channel];
+                }
+            }
+            for (int channel = 0; channel < channels; ++channel) {
+                targetRow[x * channels + channel] = static_cast<unsigned char>(std::min(pixel[channel] + 0.5f, 255.0f));
+            }
+        }
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef VS_IMAGE_SCALING
+#define VS_IMAGE_SCALING
+
+#include <cstddef>
+
+/// @brief Downscales image of 4 byte pixels by area averaging: each target pixel is mean of source pixels
+/// it covers, weighted by covered fraction. Channels are averaged independently, so premultiplied alpha stays valid.
+/// Source rows are summed into float buffer, then its columns are reduced by weights padded to the same count
+/// for every target pixel. Both loops are vectorized by the compiler.
+/// @param sourceStride, targetStride - bytes per line.
+/// @pre 0 < targetWidth <= sourceWidth, 0 < targetHeight <= sourceHeight
+void downscaleArea(
+    const unsigned char* source, int sourceWidth, int sourceHeight, size_t sourceStride,
+    unsigned char* target, int targetWidth, int targetHeight, size_t targetStride
+);
+
+/// @brief Same as downscaleArea, but makes only target rows [firstRow, firstRow + rowCount),
+/// so bands of one image can be downscaled in parallel.
+/// @pre 0 <= firstRow, 0 < rowCount, firstRow + rowCount <= targetHeight
+void downscaleAreaRows(
+    const unsigned char* source, int sourceWidth, int sourceHeight, size_t sourceStride,
+    unsigned char* target, int targetWidth, int targetHeight, size_t targetStride,
+    int firstRow, int rowCount
+);
+
+#endif //VS_IMAGE_SCALING
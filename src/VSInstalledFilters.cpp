@@ -0,0 +1,183 @@
+#include "VSInstalledFilters.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+#include <string_view>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
+
+namespace
+{
+namespace bfs = boost::filesystem;
+namespace bpt = boost::property_tree;
+
+/// @brief Reads file types from json object mapping type names to objects with MediaType.
+/// Names are not used as paths, since they may contain dots, e.g. "MS Excel 2007 XML".
+std::vector<VSInstalledFilters::FileType> readFileTypes(const bpt::ptree& tree)
+{
+    std::vector<VSInstalledFilters::FileType> fileTypes;
+    for (const auto& [name, fileType] : tree) {
+        fileTypes.push_back({name, fileType.get<std::string>("MediaType", "")});
+    }
+    std::sort(fileTypes.begin(), fileTypes.end(), [](const auto& left, const auto& right) {
+        return left.name < right.name;
+    });
+    return fileTypes;
+}
+}
+
+auto VSInstalledFilters::defaultCachePath() -> Path
+{
+    bfs::path directory;
+#ifdef _WIN32
+    if (const char* localAppData = std::getenv("LOCALAPPDATA")) {
+        directory = localAppData;
+    }
+#else
+    if (const char* cacheHome = std::getenv("XDG_CACHE_HOME")) {
+        directory = cacheHome;
+    }
+    else if (const char* home = std::getenv("HOME")) {
+        directory = bfs::path(home) / ".cache";
+    }
+#endif
+    if (directory.empty())
+    {
+        boost::system::error_code error;
+        directory = bfs::temp_directory_path(error);
+    }
+    return (directory / "lokit" / "filters.json").generic_string();
+}
+
+auto VSInstalledFilters::load(const Path& cachePath, const Path& pathToLibreOffice) -> std::optional<VSInstalledFilters>
+{
+    std::ifstream file(cachePath);
+    if (!file) {
+        return std::nullopt;
+    }
+    try {
+        bpt::ptree cache;
+        bpt::read_json(file, cache);
+        VSInstalledFilters result;
+        result.m_fingerprint = cache.get<std::string>("fingerprint");
+        if (result.m_fingerprint != fingerprint(pathToLibreOffice)) {
+            return std::nullopt;
+        }
+        result.m_versionInfo = cache.get<std::string>("version");
+        result.m_fileTypes = readFileTypes(cache.get_child("types"));
+        return result;
+    }
+    catch (const bpt::ptree_error&) {
+        return std::nullopt;
+    }
+}
+
+auto VSInstalledFilters::query(const VSLibreOffice& libreOffice, const Path& pathToLibreOffice) -> std::optional<VSInstalledFilters>
+{
+    std::string filterTypes = libreOffice.filterTypes();
+    if (filterTypes.empty()) {
+        return std::nullopt;
+    }
+    try {
+        bpt::ptree tree;
+        std::istringstream stream(filterTypes);
+        bpt::read_json(stream, tree);
+        VSInstalledFilters result;
+        result.m_fingerprint = fingerprint(pathToLibreOffice);
+        result.m_versionInfo = libreOffice.versionInfo();
+        result.m_fileTypes = readFileTypes(tree);
+        return result;
+    }
+    catch (const bpt::ptree_error&) {
+        return std::nullopt;
+    }
+}
+
+bool VSInstalledFilters::save(const Path& cachePath) const
+{
+    bpt::ptree fileTypes;
+    for (const auto& fileType : m_fileTypes)
+    {
+        bpt::ptree properties;
+        properties.put("MediaType", fileType.mediaType);
+        fileTypes.push_back({fileType.name, properties});
+    }
+    bpt::ptree cache;
+    cache.put("fingerprint", m_fingerprint);
+    cache.put("version", m_versionInfo);
+    cache.add_child("types", fileTypes);
+
+    boost::system::error_code error;
+    auto directory = bfs::path(cachePath).parent_path();
+    if (!directory.empty() && !bfs::create_directories(directory, error) && error) {
+        return false;
+    }
+    //Unique, since several processes may refresh cache at once.
+    std::string temporaryPath = cachePath + bfs::unique_path(".%%%%-%%%%.tmp").string();
+    try {
+        std::ofstream file(temporaryPath);
+        bpt::write_json(file, cache);
+        if (!file) {
+            return false;
+        }
+    }
+    catch (const bpt::ptree_error&) {
+        return false;
+    }
+    bfs::rename(temporaryPath, cachePath, error);
+    return !error;
+}
+
+auto VSInstalledFilters::fileTypes() const -> const std::vector<FileType>&
+{
+    return m_fileTypes;
+}
+
+bool VSInstalledFilters::provides(const VSFilterCatalog::Filter& filter) const
+{
+    std::string_view name = filter.fileType;
+    if (name.empty()) {
+        return true;
+    }
+    auto found = std::lower_bound(m_fileTypes.begin(), m_fileTypes.end(), name, [](const FileType& fileType, std::string_view name) {
+        return fileType.name < name;
+    });
+    return found != m_fileTypes.end() && found->name == name;
+}
+
+const std::string& VSInstalledFilters::versionInfo() const
+{
+    return m_versionInfo;
+}
+
+std::string VSInstalledFilters::fingerprint(const Path& pathToLibreOffice)
+{
+    boost::system::error_code error;
+    auto directory = bfs::canonical(pathToLibreOffice, error);
+    if (error) {
+        directory = bfs::absolute(pathToLibreOffice);
+    }
+    std::string result = directory.generic_string();
+    //Libraries LibreOfficeKit is loaded from and version files of all platforms.
+    for (const char* name : {
+        "versionrc", "version.ini", "libsofficeapp.so", "libmergedlo.so",
+        "libsofficeapp.dylib", "libmergedlo.dylib", "sofficeapp.dll", "mergedlo.dll"
+    })
+    {
+        auto path = directory / name;
+        auto size = bfs::file_size(path, error);
+        if (error) {
+            continue;
+        }
+        auto modificationTime = bfs::last_write_time(path, error);
+        if (error) {
+            continue;
+        }
+        result += "|" + std::string(name) + ":" + std::to_string(size) + ":" + std::to_string(modificationTime);
+    }
+    return result;
+}
@@ -0,0 +1,60 @@
+#ifndef VS_INSTALLED_FILTERS
+#define VS_INSTALLED_FILTERS
+
+#include <string>
+#include <vector>
+#include <optional>
+
+#include "VSLibreOffice.h"
+#include "VSFilterCatalog.h"
+
+/// @brief Filters provided by LibreOffice installation, known by TypeDetection types of files they read or write,
+/// e.g. writer8 or pdf_Portable_Document_Format, since LibreOfficeKit reports only types.
+/// Types are cached on disk together with installation fingerprint, so they are known without initializing LibreOffice.
+class VSInstalledFilters
+{
+public:
+    using Path = VSLibreOffice::Path;
+
+    struct FileType
+    {
+        std::string name;
+        std::string mediaType;
+    };
+
+    /// @brief Cache file in user cache directory.
+    static Path defaultCachePath();
+
+    /// @brief Loads file types of installation from cache.
+    /// @return nullopt if cache is missing, corrupted or made for other installation or its version.
+    static std::optional<VSInstalledFilters> load(const Path& cachePath, const Path& pathToLibreOffice);
+    /// @brief Queries file types from office initialized from pathToLibreOffice.
+    /// @pre libreOffice is inited
+    /// @return nullopt if LibreOffice does not provide filter types.
+    static std::optional<VSInstalledFilters> query(const VSLibreOffice& libreOffice, const Path& pathToLibreOffice);
+
+    /// @brief Writes cache atomically, creating its directory if needed.
+    /// @return false on failure.
+    bool save(const Path& cachePath) const;
+
+    /// @brief Sorted by name.
+    const std::vector<FileType>& fileTypes() const;
+    /// @brief Whether installation provides filter, i.e. type of files it exports.
+    /// Filters of types LibreOffice does not report are assumed to be provided.
+    bool provides(const VSFilterCatalog::Filter& filter) const;
+    /// @see VSLibreOffice::versionInfo
+    const std::string& versionInfo() const;
+
+private:
+    /// @brief Identifies installation by its path, sizes and modification times of its core libraries,
+    /// so updated installation invalidates cache.
+    static std::string fingerprint(const Path& pathToLibreOffice);
+
+    VSInstalledFilters() = default;
+
+    std::string m_fingerprint;
+    std::string m_versionInfo;
+    std::vector<FileType> m_fileTypes;
+};
+
+#endif //VS_INSTALLED_FILTERS
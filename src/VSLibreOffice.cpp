@@ -1,23 +1,81 @@
 #include "VSLibreOffice.h"
 
 #include <cassert>
+#include <algorithm>
+#include <sstream>
+#include <utility>
+#include <cctype>
+#include <numeric>
+#include <cstring>
+#include <cstdlib>
+
+#include <boost/filesystem/operations.hpp>
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/json_parser.hpp>
 
 const std::string VSLibreOffice::fileUrlPrefix = "file:///";
 
+std::string VSLibreOffice::toFileUrl(const Path& path)
+{
+    std::string absolutePath = boost::filesystem::absolute(path).generic_string();
+    //Unix paths start with '/', which is already a part of prefix.
+    size_t start = !absolutePath.empty() && absolutePath.front() == '/' ? 1 : 0;
+    std::string url = fileUrlPrefix;
+    constexpr char hexDigits[] = "0123456789ABCDEF";
+    for (size_t i = start; i < absolutePath.size(); ++i)
+    {
+        unsigned char c = absolutePath[i];
+        if (std::isalnum(c) || std::strchr("/:-._~", c)) {
+            url += static_cast<char>(c);
+        }
+        else {
+            url += '%';
+            url += hexDigits[c >> 4];
+            url += hexDigits[c & 0xF];
+        }
+    }
+    return url;
+}
+
 VSLibreOffice::Error::Error(const std::string& message) : m_message(message) {}
 
 const std::string& VSLibreOffice::Error::message() const {
     return m_message;
 }
 
-auto VSLibreOffice::init(const Path& pathToLibreOffice) -> std::optional<Error>
+auto VSLibreOffice::preinit(const Path& pathToLibreOffice, const std::optional<Path>& userProfile) -> std::optional<Error>
+{
+    std::string userProfileUrl = userProfile ? toFileUrl(*userProfile) : std::string();
+    if (lok_preinit(pathToLibreOffice.c_str(), userProfile ? userProfileUrl.c_str() : nullptr) != 0) {
+        return Error("Unable to preinitialize office from " + pathToLibreOffice);
+    }
+    return std::nullopt;
+}
+
+auto VSLibreOffice::init(const Path& pathToLibreOffice, const std::optional<Path>& userProfile) -> std::optional<Error>
 {
     assert(!isOpened());
-    m_office.reset(lok::lok_cpp_init(pathToLibreOffice.c_str()));
+    {
+        //Same as lok::lok_cpp_init, but keeps the instance.
+        VSProfiler::Scope scope(m_profiler, "lok_cpp_init");
+        m_office.reset();
+        std::string userProfileUrl = userProfile ? toFileUrl(*userProfile) : std::string();
+        m_kit = lok_init_2(pathToLibreOffice.c_str(), userProfile ? userProfileUrl.c_str() : nullptr);
+        if (m_kit && m_kit->pClass->nSize != 0) {
+            m_office = std::make_unique<lok::Office>(m_kit);
+        }
+        else {
+            m_kit = nullptr;
+        }
+    }
     if (!m_office) {
         return Error("Unable to initialize office from " + pathToLibreOffice);
     }
     else {
+        m_office->registerCallback(&VSLibreOffice::officeCallback, this);
+        if (LIBREOFFICEKIT_HAS(m_kit, setOptionalFeatures)) {
+            m_office->setOptionalFeatures(LOK_FEATURE_PART_IN_INVALIDATION_CALLBACK);
+        }
         return std::nullopt;
     }
 }
@@ -26,6 +84,7 @@ void VSLibreOffice::deinit()
 {
     close();
     m_office.reset();
+    m_kit = nullptr;
 }
 
 bool VSLibreOffice::isInited() const
@@ -37,11 +96,16 @@ auto VSLibreOffice::open(const Path& pathToFile) -> std::optional<Error>
 {
     assert(isInited());
     assert(pathToFile.find(fileUrlPrefix, 0) != 0);
-    m_document.reset(m_office->documentLoad((fileUrlPrefix + pathToFile).c_str()));
+    {
+        VSProfiler::Scope scope(m_profiler, "documentLoad");
+        m_document.reset(m_office->documentLoad(toFileUrl(pathToFile).c_str()));
+    }
     if (!m_document) {
         return makeError();
     }
     else {
+        m_document->registerCallback(&VSLibreOffice::documentCallback, this);
+        VSProfiler::Scope scope(m_profiler, "initializeForRendering");
         m_document->initializeForRendering();
         return std::nullopt;
     }
@@ -57,12 +121,26 @@ bool VSLibreOffice::isOpened() const
     return m_document != nullptr;
 }
 
+int VSLibreOffice::documentType() const
+{
+    assert(isOpened());
+    return m_document->getDocumentType();
+}
+
 int VSLibreOffice::partCount() const
 {
     assert(isOpened());
     return m_document->getParts();
 }
 
+auto VSLibreOffice::partSize() const -> TwipSize
+{
+    assert(isOpened());
+    TwipSize size{0, 0};
+    m_document->getDocumentSize(&size.width, &size.height);
+    return size;
+}
+
 int VSLibreOffice::part() const
 {
     assert(isOpened());
@@ -72,6 +150,7 @@ int VSLibreOffice::part() const
 void VSLibreOffice::setPart(int part)
 {
     assert(part >= 0 && part < partCount());
+    VSProfiler::Scope scope(m_profiler, "setPart", part);
     m_document->setPart(part);
 }
 
@@ -80,13 +159,54 @@ void VSLibreOffice::renderPart(int pixelWidth, int pixelHeight, unsigned char* b
     assert(isOpened());
     long partWidth = 0, partHeight = 0;
     m_document->getDocumentSize(&partWidth, &partHeight);
+    VSProfiler::Scope scope(m_profiler, "paintTile", m_profiler ? m_document->getPart() : VSProfiler::noPart);
     m_document->paintTile(buffer, pixelWidth, pixelHeight, 0, 0, partWidth, partHeight);
 }
 
+void VSLibreOffice::renderPartRows(int pixelWidth, int pixelHeight, int firstRow, int rowCount, unsigned char* buffer) const
+{
+    assert(isOpened());
+    assert(firstRow >= 0 && rowCount > 0 && firstRow + rowCount <= pixelHeight);
+    renderPartArea(pixelWidth, pixelHeight, 0, firstRow, pixelWidth, rowCount, buffer);
+}
+
+void VSLibreOffice::renderPartArea(int pixelWidth, int pixelHeight, int left, int top, int width, int height, unsigned char* buffer) const
+{
+    assert(isOpened());
+    assert(left >= 0 && width > 0 && left + width <= pixelWidth);
+    assert(top >= 0 && height > 0 && top + height <= pixelHeight);
+    long partWidth = 0, partHeight = 0;
+    m_document->getDocumentSize(&partWidth, &partHeight);
+    //Boundaries are computed from full image, so adjacent areas do not overlap or leave gaps.
+    auto toTwips = [](long partTwips, int pixel, int pixels) {
+        return static_cast<int>(static_cast<long long>(partTwips) * pixel / pixels);
+    };
+    int tileLeft = toTwips(partWidth, left, pixelWidth);
+    int tileTop = toTwips(partHeight, top, pixelHeight);
+    VSProfiler::Scope scope(m_profiler, "paintTile", m_profiler ? m_document->getPart() : VSProfiler::noPart);
+    m_document->paintTile(
+        buffer, width, height, tileLeft, tileTop,
+        toTwips(partWidth, left + width, pixelWidth) - tileLeft, toTwips(partHeight, top + height, pixelHeight) - tileTop
+    );
+}
+
+int VSLibreOffice::partRowsAlignment(int pixelHeight) const
+{
+    assert(isOpened());
+    long partWidth = 0, partHeight = 0;
+    m_document->getDocumentSize(&partWidth, &partHeight);
+    return pixelHeight / static_cast<int>(std::gcd(static_cast<long>(pixelHeight), partHeight));
+}
+
 auto VSLibreOffice::saveAs(const Path& path, const std::string& format) const -> std::optional<Error>
 {
     assert(isOpened());
-    if (!m_document->saveAs((fileUrlPrefix + path).c_str(), format.c_str())) {
+    bool saved = false;
+    {
+        VSProfiler::Scope scope(m_profiler, "saveAs");
+        saved = m_document->saveAs(toFileUrl(path).c_str(), format.c_str());
+    }
+    if (!saved) {
         return makeError();
     }
     else {
@@ -94,6 +214,148 @@ auto VSLibreOffice::saveAs(const Path& path, const std::string& format) const ->
     }
 }
 
+void VSLibreOffice::setProfiler(VSProfiler* profiler)
+{
+    m_profiler = profiler;
+}
+
+namespace
+{
+/// @brief Takes ownership of string allocated by LibreOffice.
+std::string takeString(char* value)
+{
+    if (!value) {
+        return {};
+    }
+    std::string result(value);
+    std::free(value);
+    return result;
+}
+}
+
+auto VSLibreOffice::renderSearchResult(const std::string& searchResult) const -> std::optional<Bitmap>
+{
+    assert(isOpened());
+    if (!LIBREOFFICEKIT_DOCUMENT_HAS(m_document->get(), renderSearchResult)) {
+        return std::nullopt;
+    }
+    unsigned char* buffer = nullptr;
+    Bitmap bitmap;
+    size_t size = 0;
+    bool isRendered = false;
+    {
+        VSProfiler::Scope scope(m_profiler, "renderSearchResult");
+        isRendered = m_document->renderSearchResult(searchResult.c_str(), &buffer, &bitmap.width, &bitmap.height, &size);
+    }
+    if (isRendered && buffer && size == static_cast<size_t>(bitmap.width) * bitmap.height * bytesPerPixel) {
+        bitmap.pixels.assign(buffer, buffer + size);
+    }
+    //Buffer is allocated by malloc.
+    std::free(buffer);
+    if (bitmap.pixels.empty()) {
+        return std::nullopt;
+    }
+    return bitmap;
+}
+
+std::string VSLibreOffice::partText()
+{
+    assert(isOpened());
+    const bool isPartSelected = m_profiler && documentType() != LOK_DOCTYPE_TEXT;
+    VSProfiler::Scope scope(m_profiler, "getTextSelection", isPartSelected ? m_document->getPart() : VSProfiler::noPart);
+    m_document->postUnoCommand(".uno:SelectAll");
+    std::string text = takeString(m_document->getTextSelection("text/plain;charset=utf-8"));
+    //Selection would be painted on images rendered afterwards.
+    m_document->resetSelection();
+    return text;
+}
+
+std::string VSLibreOffice::filterTypes() const
+{
+    assert(isInited());
+    if (!LIBREOFFICEKIT_HAS(m_kit, getFilterTypes)) {
+        return {};
+    }
+    return takeString(m_office->getFilterTypes());
+}
+
+std::string VSLibreOffice::versionInfo() const
+{
+    assert(isInited());
+    if (!LIBREOFFICEKIT_HAS(m_kit, getVersionInfo)) {
+        return {};
+    }
+    return takeString(m_office->getVersionInfo());
+}
+
+bool VSLibreOffice::trimMemory(int target)
+{
+    assert(isInited());
+    if (!LIBREOFFICEKIT_HAS(m_kit, trimMemory)) {
+        return false;
+    }
+    VSProfiler::Scope scope(m_profiler, "trimMemory");
+    m_office->trimMemory(target);
+    return true;
+}
+
+void VSLibreOffice::addFont(const Path& fontFile)
+{
+    assert(isInited());
+    m_office->setOption("addfont", toFileUrl(fontFile).c_str());
+}
+
+void VSLibreOffice::startProfileZoneRecording()
+{
+    assert(isInited());
+    m_office->setOption("profilezonerecording", "start");
+}
+
+void VSLibreOffice::stopProfileZoneRecording(std::chrono::milliseconds flushTimeout)
+{
+    assert(isInited());
+    //Recorded zones are flushed by LibreOffice timer, so wait for the next frame.
+    //It may be delivered while recording stops, so frames are counted before.
+    std::unique_lock lock(m_callbackMutex);
+    const size_t frameCount = m_profileFrameCount;
+    lock.unlock();
+    m_office->setOption("profilezonerecording", "stop");
+    lock.lock();
+    m_profileFrameReceived.wait_for(lock, flushTimeout, [&] {
+        return m_profileFrameCount != frameCount;
+    });
+}
+
+std::vector<std::string> VSLibreOffice::takeProfileZoneEvents()
+{
+    std::lock_guard lock(m_callbackMutex);
+    return std::exchange(m_profileZoneEvents, {});
+}
+
+void VSLibreOffice::setProgressListener(ProgressListener listener)
+{
+    std::lock_guard lock(m_callbackMutex);
+    m_progressListener = std::move(listener);
+}
+
+void VSLibreOffice::setInvalidationListener(InvalidationListener listener)
+{
+    std::lock_guard lock(m_callbackMutex);
+    m_invalidationListener = std::move(listener);
+}
+
+void VSLibreOffice::setErrorListener(ErrorListener listener)
+{
+    std::lock_guard lock(m_callbackMutex);
+    m_errorListener = std::move(listener);
+}
+
+void VSLibreOffice::setFontsMissingListener(FontsMissingListener listener)
+{
+    std::lock_guard lock(m_callbackMutex);
+    m_fontsMissingListener = std::move(listener);
+}
+
 VSLibreOffice::~VSLibreOffice() {
     deinit();
 }
@@ -105,4 +367,158 @@ auto VSLibreOffice::makeError() const -> Error
     Error error(message);
     m_office->freeError(message);
     return error;
-}
\ No newline at end of file
+}
+
+void VSLibreOffice::officeCallback(int type, const char* payload, void* data)
+{
+    static_cast<VSLibreOffice*>(data)->dispatchCallback(type, payload);
+}
+
+void VSLibreOffice::documentCallback(int type, const char* payload, void* data)
+{
+    static_cast<VSLibreOffice*>(data)->dispatchCallback(type, payload);
+}
+
+namespace
+{
+/// @brief Parses comma separated numbers, e.g. "0, 0, 100, 200, 1".
+std::vector<long> parseNumbers(const std::string& list)
+{
+    std::vector<long> numbers;
+    std::istringstream stream(list);
+    for (std::string number; std::getline(stream, number, ',');)
+    {
+        try {
+            numbers.push_back(std::stol(number));
+        }
+        catch (const std::exception&) {
+            break;
+        }
+    }
+    return numbers;
+}
+}
+
+void VSLibreOffice::dispatchCallback(int type, const char* payload)
+{
+    std::string payloadString = payload ? payload : "";
+    //Listeners are copied, so they are invoked without lock and may be replaced meanwhile.
+    std::unique_lock lock(m_callbackMutex);
+    switch (type)
+    {
+    case LOK_CALLBACK_PROFILE_FRAME:
+    {
+        //Frame contains one trace event per line.
+        std::istringstream frame(payloadString);
+        for (std::string event; std::getline(frame, event);) {
+            m_profileZoneEvents.push_back(std::move(event));
+        }
+        ++m_profileFrameCount;
+        lock.unlock();
+        m_profileFrameReceived.notify_all();
+        break;
+    }
+    case LOK_CALLBACK_STATUS_INDICATOR_START:
+    case LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE:
+    case LOK_CALLBACK_STATUS_INDICATOR_FINISH:
+    {
+        auto listener = m_progressListener;
+        lock.unlock();
+        if (!listener) {
+            break;
+        }
+        Progress progress;
+        if (type == LOK_CALLBACK_STATUS_INDICATOR_START)
+        {
+            progress.stage = Progress::Stage::Start;
+            progress.text = payloadString;
+        }
+        else if (type == LOK_CALLBACK_STATUS_INDICATOR_SET_VALUE)
+        {
+            progress.stage = Progress::Stage::Value;
+            auto numbers = parseNumbers(payloadString);
+            progress.percent = numbers.empty() ? 0 : static_cast<int>(numbers.front());
+        }
+        else {
+            progress.stage = Progress::Stage::Finish;
+        }
+        listener(progress);
+        break;
+    }
+    case LOK_CALLBACK_INVALIDATE_TILES:
+    {
+        auto listener = m_invalidationListener;
+        lock.unlock();
+        if (!listener) {
+            break;
+        }
+        //Payload is "x, y, width, height[, part[, mode]]" or "EMPTY[, part[, mode]]".
+        Invalidation invalidation;
+        const std::string empty = "EMPTY";
+        if (payloadString.compare(0, empty.size(), empty) == 0)
+        {
+            auto numbers = parseNumbers(payloadString.substr(std::min(payloadString.size(), empty.size() + 1)));
+            if (!numbers.empty()) {
+                invalidation.part = static_cast<int>(numbers[0]);
+            }
+        }
+        else
+        {
+            auto numbers = parseNumbers(payloadString);
+            if (numbers.size() < 4) {
+                break;
+            }
+            invalidation.area = Invalidation::Rectangle{numbers[0], numbers[1], numbers[2], numbers[3]};
+            if (numbers.size() > 4) {
+                invalidation.part = static_cast<int>(numbers[4]);
+            }
+        }
+        listener(invalidation);
+        break;
+    }
+    case LOK_CALLBACK_ERROR:
+    {
+        auto listener = m_errorListener;
+        lock.unlock();
+        if (!listener) {
+            break;
+        }
+        //Payload is json object with "message" among other fields.
+        std::string message = payloadString;
+        try {
+            boost::property_tree::ptree error;
+            std::istringstream stream(payloadString);
+            boost::property_tree::read_json(stream, error);
+            message = error.get<std::string>("message", payloadString);
+        }
+        catch (const boost::property_tree::ptree_error&) {}
+        listener(Error(message));
+        break;
+    }
+    case LOK_CALLBACK_FONTS_MISSING:
+    {
+        auto listener = m_fontsMissingListener;
+        lock.unlock();
+        if (!listener) {
+            break;
+        }
+        //Payload is json object with "fontsmissing" array of font family names.
+        std::vector<std::string> fontFamilies;
+        try {
+            boost::property_tree::ptree fonts;
+            std::istringstream stream(payloadString);
+            boost::property_tree::read_json(stream, fonts);
+            for (const auto& [name, font] : fonts.get_child("fontsmissing")) {
+                fontFamilies.push_back(font.get_value<std::string>());
+            }
+        }
+        catch (const boost::property_tree::ptree_error&) {}
+        if (!fontFamilies.empty()) {
+            listener(fontFamilies);
+        }
+        break;
+    }
+    default:
+        break;
+    }
+}
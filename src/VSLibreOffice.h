@@ -4,10 +4,17 @@
 #include <string>
 #include <memory>
 #include <optional>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
 
 #define LOK_USE_UNSTABLE_API
 #include <LibreOfficeKit.hxx>
 
+#include "VSProfiler.h"
+
 class VSLibreOffice
 {
 public:
@@ -24,12 +31,20 @@ public:
     };
 
     static const std::string fileUrlPrefix;
+    /// @brief Makes file URL from absolute or relative path, percent encoding reserved characters.
+    static std::string toFileUrl(const Path& path);
+
+    /// @brief Loads LibreOffice libraries and preinitializes office without creating instance,
+    /// so processes forked afterwards share loaded code and only finish initialization by init.
+    /// @param userProfile - must be the same as passed to init later.
+    static std::optional<Error> preinit(const Path& pathToLibreOffice, const std::optional<Path>& userProfile = std::nullopt);
 
     VSLibreOffice() = default;
 
     /// @brief deinitilizes office if already initialized, and tries to initialize new instance of office.
+    /// @param userProfile - directory of user profile, if not set LibreOffice uses default profile of user.
     /// @pre is not opened.
-    std::optional<Error> init(const Path& pathToLibreOffice);
+    std::optional<Error> init(const Path& pathToLibreOffice, const std::optional<Path>& userProfile = std::nullopt);
     /// @brief closes document if opened and deinitilizes office if initialized.
     void deinit();
     bool isInited() const;
@@ -41,8 +56,19 @@ public:
     void close();
     bool isOpened() const;
 
+    /// @pre is opened
+    /// @return one of LOK_DOCTYPE_* values.
+    int documentType() const;
     /// @pre is opened
     int partCount() const;
+    struct TwipSize
+    {
+        long width;
+        long height;
+    };
+    /// @brief Size of current part in twips, 1440 twips per inch.
+    /// @pre is opened
+    TwipSize partSize() const;
     /// @pre is opened
     /// @return current part
     int part() const;
@@ -55,6 +81,41 @@ public:
     /// @param buffer - Buffer must accept at least bytesPerPixel * pixelWidth * pixelHeight of type unsinged char.
     /// @pre is opened
     void renderPart(int pixelWidth, int pixelHeight, unsigned char* buffer) const;
+    /// @brief Renders rows [firstRow, firstRow + rowCount) of document part rendered at pixelWidth x pixelHeight,
+    /// so big images can be rendered by strips without LibreOffice allocating whole image internally.
+    /// @param buffer - Buffer must accept at least bytesPerPixel * pixelWidth * rowCount of type unsinged char.
+    /// @pre is opened and rows are in range [0, pixelHeight)
+    void renderPartRows(int pixelWidth, int pixelHeight, int firstRow, int rowCount, unsigned char* buffer) const;
+    /// @brief Renders pixels [left, left + width) x [top, top + height) of document part rendered at pixelWidth x pixelHeight.
+    /// Boundaries are mapped to twips proportionally, so adjacent areas neither overlap nor leave gaps.
+    /// @param buffer - Buffer must accept at least bytesPerPixel * width * height of type unsinged char.
+    /// @pre is opened and area is inside of [0, pixelWidth) x [0, pixelHeight)
+    void renderPartArea(int pixelWidth, int pixelHeight, int left, int top, int width, int height, unsigned char* buffer) const;
+    /// @brief Strips starting at multiples of returned rows count start at whole twips,
+    /// so they are rendered exactly as rows of the whole part. May be greater than pixelHeight.
+    /// @pre is opened
+    int partRowsAlignment(int pixelHeight) const;
+
+    /// @brief Image rendered by LibreOffice in ARGB32 format, lines are not padded.
+    struct Bitmap
+    {
+        int width = 0;
+        int height = 0;
+        std::vector<unsigned char> pixels;
+    };
+    /// @brief Renders area of text document occupied by paragraph found by search.
+    /// @param searchResult - xml identifying paragraph, e.g. <indexing><paragraph node_type="writer" index="3"/></indexing>,
+    /// made from output of writer_indexing_export filter.
+    /// @pre is opened
+    /// @return nullopt if LibreOffice does not support rendering of search results, i.e. older than 7.2,
+    /// or has not found the paragraph.
+    std::optional<Bitmap> renderSearchResult(const std::string& searchResult) const;
+
+    /// @brief Selects all content of current part and takes it as UTF-8 plain text, selection is reset afterwards.
+    /// Text of presentation and drawing parts is text of their shapes.
+    /// Pages of text document are not selected separately, its text is text of the whole document.
+    /// @pre is opened
+    std::string partText();
 
     /// @brief Saves document in specified format,
     /// if path refers to existing file, overwrites it.
@@ -62,6 +123,78 @@ public:
     /// @return true on success
     std::optional<Error> saveAs(const Path& path, const std::string& format) const;
 
+    /// @brief Sets profiler which records init, load, render and save stages,
+    /// nullptr disables profiling.
+    /// @param profiler - must outlive this object or be reset.
+    void setProfiler(VSProfiler* profiler);
+
+    /// @brief Json object mapping names of filters provided by LibreOffice to objects with their MediaType.
+    /// @pre is inited
+    /// @return empty string if LibreOffice does not provide filter types, i.e. older than 6.0.
+    std::string filterTypes() const;
+    /// @brief Json object with ProductName, ProductVersion, ProductExtension and BuildId.
+    /// @pre is inited
+    /// @return empty string if LibreOffice does not provide version info.
+    std::string versionInfo() const;
+
+    /// @brief Asks LibreOffice to release caches.
+    /// @param target - number >= 1000 encourages maximal saving, negative means office is back in active use.
+    /// @pre is inited
+    /// @return false if LibreOffice does not support trimming, i.e. older than 7.6.
+    bool trimMemory(int target);
+
+    /// @brief Registers font file for documents opened afterwards without installing it to the system.
+    /// LibreOffice rebuilds its font list on each call, so fonts are better added once after init.
+    /// @pre is inited
+    void addFont(const Path& fontFile);
+
+    /// @brief Starts recording of LibreOffice internal profile zones.
+    /// @pre is inited
+    void startProfileZoneRecording();
+    /// @brief Stops recording of profile zones and waits
+    /// till LibreOffice delivers recorded zones or timeout expires.
+    /// @pre is inited
+    void stopProfileZoneRecording(std::chrono::milliseconds flushTimeout = std::chrono::milliseconds(1500));
+    /// @return Chrome Trace Events received from LibreOffice since last call.
+    std::vector<std::string> takeProfileZoneEvents();
+
+    /// @brief Progress of long operation, e.g. document loading.
+    struct Progress
+    {
+        enum class Stage { Start, Value, Finish };
+        Stage stage;
+        /// @brief Percentage, set at Value stage.
+        int percent = 0;
+        /// @brief Description of operation, may be set at Start stage.
+        std::string text;
+    };
+    /// @brief Area of document which has to be rendered again.
+    struct Invalidation
+    {
+        struct Rectangle
+        {
+            long x;
+            long y;
+            long width;
+            long height;
+        };
+        /// @brief Twips, not set if whole document is invalid.
+        std::optional<Rectangle> area;
+        /// @brief Invalidated part, VSProfiler::noPart if not reported.
+        int part = VSProfiler::noPart;
+    };
+    using ProgressListener = std::function<void(const Progress&)>;
+    using InvalidationListener = std::function<void(const Invalidation&)>;
+    using ErrorListener = std::function<void(const Error&)>;
+    /// @brief Receives families of fonts used by opened document but not available, so they are substituted by fallback fonts.
+    using FontsMissingListener = std::function<void(const std::vector<std::string>& fontFamilies)>;
+    /// @brief Listeners are invoked on thread LibreOffice emits events on, possibly during calls to this object.
+    /// Listener must not call this object. Empty listener removes previous one.
+    void setProgressListener(ProgressListener listener);
+    void setInvalidationListener(InvalidationListener listener);
+    void setErrorListener(ErrorListener listener);
+    void setFontsMissingListener(FontsMissingListener listener);
+
     /// @brief Closes file if opened, deinitializes if inited.
     ~VSLibreOffice();
 
@@ -69,9 +202,27 @@ private:
     /// @pre is inited
     Error makeError() const;
 
+    static void officeCallback(int type, const char* payload, void* data);
+    static void documentCallback(int type, const char* payload, void* data);
+    //Events of office and document do not intersect, so both are dispatched by single function.
+    void dispatchCallback(int type, const char* payload);
+
 
     std::unique_ptr<lok::Office> m_office;
+    //Instance wrapped by m_office, needed to check which functions are provided by LibreOffice version.
+    LibreOfficeKit* m_kit = nullptr;
     std::unique_ptr<lok::Document> m_document;
+    VSProfiler* m_profiler = nullptr;
+
+    //LibreOffice invokes callbacks from its own thread.
+    std::mutex m_callbackMutex;
+    std::condition_variable m_profileFrameReceived;
+    std::vector<std::string> m_profileZoneEvents;
+    size_t m_profileFrameCount = 0;
+    ProgressListener m_progressListener;
+    InvalidationListener m_invalidationListener;
+    ErrorListener m_errorListener;
+    FontsMissingListener m_fontsMissingListener;
 };
 
 #endif //VS_LIBRE_OFFICE
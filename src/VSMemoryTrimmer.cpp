@@ -0,0 +1,99 @@
+#include "VSMemoryTrimmer.h"
+#include "VSSystem.h"
+
+#include <cassert>
+
+bool VSMemoryTrimmer::Policy::isEnabled() const
+{
+    return documentCount || idleTime || residentSetSizeWatermark;
+}
+
+VSMemoryTrimmer::VSMemoryTrimmer(VSLibreOffice& libreOffice, Policy policy, Reporter reporter)
+    : m_libreOffice(libreOffice), m_policy(std::move(policy)), m_reporter(std::move(reporter))
+{
+    assert(m_libreOffice.isInited());
+    if (m_policy.idleTime) {
+        m_idleWatcher = std::thread(&VSMemoryTrimmer::watchIdle, this);
+    }
+}
+
+VSMemoryTrimmer::~VSMemoryTrimmer()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_idleChanged.notify_all();
+    if (m_idleWatcher.joinable()) {
+        m_idleWatcher.join();
+    }
+}
+
+void VSMemoryTrimmer::idleEnd()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_idle = false;
+    }
+    m_idleChanged.notify_all();
+}
+
+void VSMemoryTrimmer::documentProcessed()
+{
+    std::unique_lock lock(m_mutex);
+    assert(!m_idle);
+    ++m_documentsSinceTrim;
+    if (m_policy.documentCount && m_documentsSinceTrim >= *m_policy.documentCount) {
+        trim("documents");
+    }
+    else if (m_policy.residentSetSizeWatermark)
+    {
+        auto rss = residentSetSize();
+        if (rss && *rss > *m_policy.residentSetSizeWatermark) {
+            trim("watermark");
+        }
+    }
+}
+
+void VSMemoryTrimmer::idleBegin()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_idle = true;
+        ++m_idlePeriod;
+    }
+    m_idleChanged.notify_all();
+}
+
+void VSMemoryTrimmer::trim(const std::string& reason)
+{
+    auto before = residentSetSize();
+    if (!m_libreOffice.trimMemory(m_policy.target)) {
+        return;
+    }
+    m_documentsSinceTrim = 0;
+    auto after = residentSetSize();
+    if (m_reporter) {
+        m_reporter(reason, before, after);
+    }
+}
+
+void VSMemoryTrimmer::watchIdle()
+{
+    assert(m_policy.idleTime);
+    std::unique_lock lock(m_mutex);
+    while (!m_stopping)
+    {
+        m_idleChanged.wait(lock, [this] { return m_stopping || (m_idle && m_idlePeriod != m_trimmedIdlePeriod); });
+        if (m_stopping) {
+            break;
+        }
+        auto period = m_idlePeriod;
+        //Office is used only after idleEnd, which waits for the mutex held during trim.
+        if (!m_idleChanged.wait_for(lock, *m_policy.idleTime, [&] { return m_stopping || !m_idle || m_idlePeriod != period; }))
+        {
+            trim("idle");
+            m_trimmedIdlePeriod = period;
+        }
+    }
+}
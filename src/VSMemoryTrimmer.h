@@ -0,0 +1,72 @@
+#ifndef VS_MEMORY_TRIMMER
+#define VS_MEMORY_TRIMMER
+
+#include <optional>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <string>
+
+#include "VSLibreOffice.h"
+
+/// @brief Calls VSLibreOffice::trimMemory according to policy,
+/// so long living process does not grow because of LibreOffice caches.
+class VSMemoryTrimmer
+{
+public:
+    struct Policy
+    {
+        /// @brief Trim after this count of documents processed since previous trim.
+        std::optional<int> documentCount;
+        /// @brief Trim once office stays idle for this time.
+        std::optional<std::chrono::milliseconds> idleTime;
+        /// @brief Trim after document if resident set size exceeds this bytes count.
+        std::optional<size_t> residentSetSizeWatermark;
+        /// @see VSLibreOffice::trimMemory
+        int target = 1000;
+
+        bool isEnabled() const;
+    };
+
+    /// @brief Invoked after each trim with reason and resident set sizes before and after it.
+    using Reporter = std::function<void(const std::string& reason, std::optional<size_t> before, std::optional<size_t> after)>;
+
+    /// @param libreOffice - must outlive trimmer.
+    /// @pre libreOffice is inited
+    VSMemoryTrimmer(VSLibreOffice& libreOffice, Policy policy, Reporter reporter);
+    VSMemoryTrimmer(const VSMemoryTrimmer&) = delete;
+    VSMemoryTrimmer& operator=(const VSMemoryTrimmer&) = delete;
+    /// @brief Stops idle watching.
+    ~VSMemoryTrimmer();
+
+    /// @brief Must be called before using office after idleBegin,
+    /// waits for trim started on idle to finish.
+    void idleEnd();
+    /// @brief Must be called after each processed document,
+    /// trims if document count or watermark are reached.
+    void documentProcessed();
+    /// @brief Marks that office is not used till idleEnd, starts idle timer.
+    void idleBegin();
+
+private:
+    void trim(const std::string& reason);
+    void watchIdle();
+
+    VSLibreOffice& m_libreOffice;
+    Policy m_policy;
+    Reporter m_reporter;
+    int m_documentsSinceTrim = 0;
+
+    std::mutex m_mutex;
+    std::condition_variable m_idleChanged;
+    bool m_idle = false;
+    //Incremented by idleBegin, trim happens at most once per idle period.
+    unsigned long long m_idlePeriod = 0;
+    unsigned long long m_trimmedIdlePeriod = 0;
+    bool m_stopping = false;
+    std::thread m_idleWatcher;
+};
+
+#endif //VS_MEMORY_TRIMMER
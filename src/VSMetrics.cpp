@@ -0,0 +1,164 @@
+#include "VSMetrics.h"
+#include "VSSystem.h"
+
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+
+namespace
+{
+/// @brief Escapes label value which is not known in advance, e.g. font name.
+std::string escapeLabelValue(const std::string& value)
+{
+    std::string result;
+    for (char c : value)
+    {
+        if (c == '\n')
+        {
+            result += "\\n";
+            continue;
+        }
+        if (c == '\\' || c == '"') {
+            result += '\\';
+        }
+        result += c;
+    }
+    return result;
+}
+}
+
+const std::vector<double> VSMetrics::durationBuckets = {
+    0.005, 0.01, 0.025, 0.05, 0.1, 0.25, 0.5, 1, 2.5, 5, 10, 30, 60
+};
+
+void VSMetrics::documentProcessed()
+{
+    std::lock_guard lock(m_mutex);
+    ++m_documentsProcessed;
+}
+
+void VSMetrics::failure(const std::string& cause)
+{
+    std::lock_guard lock(m_mutex);
+    ++m_failures[cause];
+}
+
+void VSMetrics::bytesWritten(uintmax_t bytes)
+{
+    std::lock_guard lock(m_mutex);
+    m_bytesWritten += bytes;
+}
+
+void VSMetrics::partDeduplicated()
+{
+    std::lock_guard lock(m_mutex);
+    ++m_partsDeduplicated;
+}
+
+void VSMetrics::fontMissing(const std::string& fontFamily)
+{
+    std::lock_guard lock(m_mutex);
+    ++m_missingFonts[fontFamily];
+}
+
+void VSMetrics::observe(const std::string& stage, VSProfiler::Duration duration)
+{
+    double seconds = duration.count() / 1e6;
+    std::lock_guard lock(m_mutex);
+    auto& histogram = m_stageDurations[stage];
+    for (size_t i = 0; i < durationBuckets.size(); ++i)
+    {
+        if (seconds <= durationBuckets[i]) {
+            ++histogram.bucketCounts[i];
+        }
+    }
+    ++histogram.count;
+    histogram.sum += seconds;
+}
+
+void VSMetrics::memoryTrimmed(const std::string& reason, long long freedBytes)
+{
+    std::lock_guard lock(m_mutex);
+    ++m_memoryTrims[reason];
+    m_memoryTrimmedBytes += freedBytes;
+}
+
+void VSMetrics::write(std::ostream& stream) const
+{
+    std::lock_guard lock(m_mutex);
+    stream << "# HELP lokit_documents_processed_total Documents processed.\n"
+           << "# TYPE lokit_documents_processed_total counter\n"
+           << "lokit_documents_processed_total " << m_documentsProcessed << "\n";
+
+    stream << "# HELP lokit_failures_total Failures by cause.\n"
+           << "# TYPE lokit_failures_total counter\n";
+    for (const auto& [cause, count] : m_failures) {
+        stream << "lokit_failures_total{cause=\"" << cause << "\"} " << count << "\n";
+    }
+
+    stream << "# HELP lokit_written_bytes_total Bytes of converted files and images written.\n"
+           << "# TYPE lokit_written_bytes_total counter\n"
+           << "lokit_written_bytes_total " << m_bytesWritten << "\n";
+
+    stream << "# HELP lokit_deduplicated_parts_total Parts rendered the same as previous part of document, whose images were not encoded.\n"
+           << "# TYPE lokit_deduplicated_parts_total counter\n"
+           << "lokit_deduplicated_parts_total " << m_partsDeduplicated << "\n";
+
+    stream << "# HELP lokit_missing_fonts_total Documents using font family which was not available and was substituted.\n"
+           << "# TYPE lokit_missing_fonts_total counter\n";
+    for (const auto& [fontFamily, count] : m_missingFonts) {
+        stream << "lokit_missing_fonts_total{font=\"" << escapeLabelValue(fontFamily) << "\"} " << count << "\n";
+    }
+
+    stream << "# HELP lokit_stage_duration_seconds Duration of processing stages, e.g. documentLoad, paintTile, encode.\n"
+           << "# TYPE lokit_stage_duration_seconds histogram\n";
+    for (const auto& [stage, histogram] : m_stageDurations)
+    {
+        for (size_t i = 0; i < durationBuckets.size(); ++i)
+        {
+            stream << "lokit_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"" << durationBuckets[i] << "\"} "
+                   << histogram.bucketCounts[i] << "\n";
+        }
+        stream << "lokit_stage_duration_seconds_bucket{stage=\"" << stage << "\",le=\"+Inf\"} " << histogram.count << "\n"
+               << "lokit_stage_duration_seconds_sum{stage=\"" << stage << "\"} " << histogram.sum << "\n"
+               << "lokit_stage_duration_seconds_count{stage=\"" << stage << "\"} " << histogram.count << "\n";
+    }
+
+    stream << "# HELP lokit_memory_trims_total LibreOffice memory trims by reason.\n"
+           << "# TYPE lokit_memory_trims_total counter\n";
+    for (const auto& [reason, count] : m_memoryTrims) {
+        stream << "lokit_memory_trims_total{reason=\"" << reason << "\"} " << count << "\n";
+    }
+    stream << "# HELP lokit_memory_trimmed_bytes_total Decrease of resident set size caused by trims.\n"
+           << "# TYPE lokit_memory_trimmed_bytes_total counter\n"
+           << "lokit_memory_trimmed_bytes_total " << m_memoryTrimmedBytes << "\n";
+
+    if (auto rss = residentSetSize())
+    {
+        stream << "# HELP lokit_resident_memory_bytes Resident set size.\n"
+               << "# TYPE lokit_resident_memory_bytes gauge\n"
+               << "lokit_resident_memory_bytes " << *rss << "\n";
+    }
+    if (auto peakRss = peakResidentSetSize())
+    {
+        stream << "# HELP lokit_peak_resident_memory_bytes Peak resident set size.\n"
+               << "# TYPE lokit_peak_resident_memory_bytes gauge\n"
+               << "lokit_peak_resident_memory_bytes " << *peakRss << "\n";
+    }
+    stream.flush();
+}
+
+bool VSMetrics::writeToFile(const std::string& path) const
+{
+    std::string temporaryPath = path + ".tmp";
+    {
+        std::ofstream file(temporaryPath);
+        write(file);
+        if (!file) {
+            return false;
+        }
+    }
+    boost::system::error_code error;
+    boost::filesystem::rename(temporaryPath, path, error);
+    return !error;
+}
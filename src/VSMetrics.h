@@ -0,0 +1,59 @@
+#ifndef VS_METRICS
+#define VS_METRICS
+
+#include <string>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <cstdint>
+
+#include "VSProfiler.h"
+
+/// @brief Counters and histograms of processed documents, exposed in Prometheus text format.
+/// Thread safe.
+class VSMetrics
+{
+public:
+    /// @brief Upper bounds of stage duration histogram buckets in seconds.
+    static const std::vector<double> durationBuckets;
+
+    void documentProcessed();
+    /// @param cause - short label value, e.g. load, render, save.
+    void failure(const std::string& cause);
+    void bytesWritten(uintmax_t bytes);
+    /// @brief Part rendered the same as previous part of document, so its images were not encoded.
+    void partDeduplicated();
+    /// @brief Font family used by document was not available and was substituted.
+    void fontMissing(const std::string& fontFamily);
+    void observe(const std::string& stage, VSProfiler::Duration duration);
+    /// @param freedBytes - difference of resident set size before and after trim, may be negative.
+    void memoryTrimmed(const std::string& reason, long long freedBytes);
+
+    /// @brief Writes metrics including current resident set size in Prometheus text exposition format.
+    void write(std::ostream& stream) const;
+    /// @brief Writes metrics to temporary file and renames it to path,
+    /// so readers never observe partially written file.
+    /// @return true on success
+    bool writeToFile(const std::string& path) const;
+
+private:
+    struct Histogram
+    {
+        std::vector<uint64_t> bucketCounts = std::vector<uint64_t>(durationBuckets.size(), 0);
+        uint64_t count = 0;
+        double sum = 0;
+    };
+
+    mutable std::mutex m_mutex;
+    uint64_t m_documentsProcessed = 0;
+    std::map<std::string, uint64_t> m_failures;
+    uintmax_t m_bytesWritten = 0;
+    uint64_t m_partsDeduplicated = 0;
+    std::map<std::string, uint64_t> m_missingFonts;
+    std::map<std::string, Histogram> m_stageDurations;
+    std::map<std::string, uint64_t> m_memoryTrims;
+    long long m_memoryTrimmedBytes = 0;
+};
+
+#endif //VS_METRICS
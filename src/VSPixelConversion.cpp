@@ -0,0 +1,191 @@
+#include "VSPixelConversion.h"
+
+#include <cstring>
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+/// @brief Exact rounded value / 255 for value <= 255 * 255.
+inline uint32_t divideBy255(uint32_t value)
+{
+    value += 128;
+    return (value + (value >> 8)) >> 8;
+}
+
+/// @brief Pixels composited at a time. Chunk is copied from source before target is written,
+/// so loops over chunk do not alias target and have constant trip count.
+constexpr int chunkPixels = 64;
+
+/// @brief Premultiplied color never exceeds alpha, but malformed pixels are clamped.
+inline unsigned char compositeChannel(uint32_t channel, uint32_t background, uint32_t transparency)
+{
+    return static_cast<unsigned char>(std::min<uint32_t>(channel + divideBy255(background * transparency), 255));
+}
+
+struct Channels
+{
+    unsigned char red[chunkPixels];
+    unsigned char green[chunkPixels];
+    unsigned char blue[chunkPixels];
+};
+
+/// @brief Composites chunk of pixels over background into separate channels.
+/// Pixels are read as integers, so channels do not depend on byte order.
+/// Channels are returned rather than written through parameters, which could alias pixels.
+Channels compositeChunk(const uint32_t (&pixels)[chunkPixels], uint32_t background)
+{
+    const uint32_t backgroundRed = (background >> 16) & 0xFF;
+    const uint32_t backgroundGreen = (background >> 8) & 0xFF;
+    const uint32_t backgroundBlue = background & 0xFF;
+    Channels channels;
+    for (int i = 0; i < chunkPixels; ++i)
+    {
+        const uint32_t transparency = 255 - (pixels[i] >> 24);
+        channels.red[i] = compositeChannel((pixels[i] >> 16) & 0xFF, backgroundRed, transparency);
+        channels.green[i] = compositeChannel((pixels[i] >> 8) & 0xFF, backgroundGreen, transparency);
+        channels.blue[i] = compositeChannel(pixels[i] & 0xFF, backgroundBlue, transparency);
+    }
+    return channels;
+}
+}
+
+void compositeOver(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    uint32_t background, unsigned char* target, size_t targetStride
+)
+{
+    //Tail of last chunk holds stale pixels, whose channels are computed but not written.
+    uint32_t pixels[chunkPixels] = {};
+    unsigned char composited[chunkPixels * 3];
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* sourceRow = source + y * sourceStride;
+        unsigned char* targetRow = target + y * targetStride;
+        for (int x = 0; x < width; x += chunkPixels)
+        {
+            const int count = std::min(chunkPixels, width - x);
+            std::memcpy(pixels, sourceRow + x * 4, count * sizeof(uint32_t));
+            const Channels channels = compositeChunk(pixels, background);
+            for (int i = 0; i < chunkPixels; ++i)
+            {
+                composited[i * 3] = channels.red[i];
+                composited[i * 3 + 1] = channels.green[i];
+                composited[i * 3 + 2] = channels.blue[i];
+            }
+            std::memcpy(targetRow + x * 3, composited, count * 3);
+        }
+    }
+}
+
+void compositeOverGray(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    uint32_t background, unsigned char* target, size_t targetStride
+)
+{
+    uint32_t pixels[chunkPixels] = {};
+    unsigned char gray[chunkPixels];
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* sourceRow = source + y * sourceStride;
+        unsigned char* targetRow = target + y * targetStride;
+        for (int x = 0; x < width; x += chunkPixels)
+        {
+            const int count = std::min(chunkPixels, width - x);
+            std::memcpy(pixels, sourceRow + x * 4, count * sizeof(uint32_t));
+            const Channels channels = compositeChunk(pixels, background);
+            for (int i = 0; i < chunkPixels; ++i)
+            {
+                //ITU-R BT.601 luma in 8 bit fixed point, weights sum to 256.
+                gray[i] = static_cast<unsigned char>((77 * channels.red[i] + 150 * channels.green[i] + 29 * channels.blue[i] + 128) >> 8);
+            }
+            std::memcpy(targetRow + x, gray, count);
+        }
+    }
+}
+
+std::vector<uint32_t> quantizePopularity(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    unsigned char* target, size_t targetStride
+)
+{
+    constexpr int cellCount = 1 << 15;
+    constexpr size_t maxColors = 256;
+    auto cellOf = [](const unsigned char* pixel) {
+        return ((pixel[0] >> 3) << 10) | ((pixel[1] >> 3) << 5) | (pixel[2] >> 3);
+    };
+    struct Cell
+    {
+        uint32_t count = 0;
+        uint64_t red = 0;
+        uint64_t green = 0;
+        uint64_t blue = 0;
+    };
+    std::vector<Cell> cells(cellCount);
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* row = source + y * sourceStride;
+        for (int x = 0; x < width; ++x)
+        {
+            const unsigned char* pixel = row + x * 3;
+            auto& cell = cells[cellOf(pixel)];
+            ++cell.count;
+            cell.red += pixel[0];
+            cell.green += pixel[1];
+            cell.blue += pixel[2];
+        }
+    }
+    std::vector<int> used;
+    for (int i = 0; i < cellCount; ++i)
+    {
+        if (cells[i].count != 0) {
+            used.push_back(i);
+        }
+    }
+    size_t colorCount = std::min(used.size(), maxColors);
+    std::partial_sort(used.begin(), used.begin() + colorCount, used.end(), [&](int left, int right) {
+        return cells[left].count > cells[right].count;
+    });
+    //Palette colors are means of their cells, so images with few colors are kept exactly.
+    std::vector<uint32_t> palette(colorCount);
+    std::vector<unsigned char> indexOfCell(cellCount);
+    for (size_t i = 0; i < colorCount; ++i)
+    {
+        const auto& cell = cells[used[i]];
+        uint32_t red = static_cast<uint32_t>((cell.red + cell.count / 2) / cell.count);
+        uint32_t green = static_cast<uint32_t>((cell.green + cell.count / 2) / cell.count);
+        uint32_t blue = static_cast<uint32_t>((cell.blue + cell.count / 2) / cell.count);
+        palette[i] = 0xFF000000 | (red << 16) | (green << 8) | blue;
+        indexOfCell[used[i]] = static_cast<unsigned char>(i);
+    }
+    //Cells left out of palette take nearest palette color to their mean.
+    for (size_t i = colorCount; i < used.size(); ++i)
+    {
+        const auto& cell = cells[used[i]];
+        long red = static_cast<long>(cell.red / cell.count);
+        long green = static_cast<long>(cell.green / cell.count);
+        long blue = static_cast<long>(cell.blue / cell.count);
+        long nearestDistance = std::numeric_limits<long>::max();
+        for (size_t color = 0; color < colorCount; ++color)
+        {
+            long redDifference = red - static_cast<long>((palette[color] >> 16) & 0xFF);
+            long greenDifference = green - static_cast<long>((palette[color] >> 8) & 0xFF);
+            long blueDifference = blue - static_cast<long>(palette[color] & 0xFF);
+            long distance = redDifference * redDifference + greenDifference * greenDifference + blueDifference * blueDifference;
+            if (distance < nearestDistance)
+            {
+                nearestDistance = distance;
+                indexOfCell[used[i]] = static_cast<unsigned char>(color);
+            }
+        }
+    }
+    for (int y = 0; y < height; ++y)
+    {
+        const unsigned char* sourceRow = source + y * sourceStride;
+        unsigned char* targetRow = target + y * targetStride;
+        for (int x = 0; x < width; ++x) {
+            targetRow[x] = indexOfCell[cellOf(sourceRow + x * 3)];
+        }
+    }
+    return palette;
+}
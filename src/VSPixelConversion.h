@@ -0,0 +1,38 @@
+#ifndef VS_PIXEL_CONVERSION
+#define VS_PIXEL_CONVERSION
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/// @brief Composites image in premultiplied ARGB32 format (0xAARRGGBB) over opaque background,
+/// writing RGB888 format (bytes R, G, B). Premultiplied color only needs background scaled by transparency added,
+/// so alpha is removed without division. Pixels are composited in chunks copied from source into separate channels
+/// by loop the compiler vectorizes also in place, channels are then interleaved into target.
+/// @param background - color 0xRRGGBB.
+/// @param target - may be source if targetStride <= sourceStride, since pixels are written behind read ones.
+/// @param sourceStride, targetStride - bytes per line.
+void compositeOver(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    uint32_t background, unsigned char* target, size_t targetStride
+);
+
+/// @brief Composites image in premultiplied ARGB32 format over opaque background like compositeOver
+/// and writes its luminance, one byte per pixel. Luminance of chunk is computed from separate channels by loop
+/// the compiler vectorizes.
+/// @param target - may be source if targetStride <= sourceStride.
+void compositeOverGray(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    uint32_t background, unsigned char* target, size_t targetStride
+);
+
+/// @brief Reduces image in RGB888 format to at most 256 colors by popularity: colors are counted in 5 bits per channel
+/// histogram, the most frequent cells become palette and every cell is mapped to the nearest palette color.
+/// @param target - receives palette index per pixel, may be source if targetStride <= sourceStride.
+/// @return palette, colors are 0xFFRRGGBB.
+std::vector<uint32_t> quantizePopularity(
+    const unsigned char* source, int width, int height, size_t sourceStride,
+    unsigned char* target, size_t targetStride
+);
+
+#endif //VS_PIXEL_CONVERSION
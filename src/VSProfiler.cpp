@@ -0,0 +1,228 @@
+#include "VSProfiler.h"
+
+#include <map>
+#include <cctype>
+#include <iomanip>
+#include <utility>
+#include <thread>
+#include <functional>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <process.h>
+#define getpid _getpid
+#else
+#include <ctime>
+#include <unistd.h>
+#endif
+
+VSProfiler::Scope::Scope(VSProfiler* profiler, std::string stage, int part)
+    : m_profiler(profiler), m_stage(std::move(stage)), m_part(part)
+{
+    if (m_profiler) {
+        m_wallStart = Clock::now();
+        m_cpuStart = threadCpuTime();
+    }
+}
+
+VSProfiler::Scope::~Scope()
+{
+    if (!m_profiler) {
+        return;
+    }
+    auto cpuEnd = threadCpuTime();
+    auto wallEnd = Clock::now();
+    Span span{
+        std::move(m_stage),
+        m_part,
+        std::chrono::duration_cast<Duration>(m_wallStart - m_profiler->m_creationTime),
+        std::chrono::duration_cast<Duration>(wallEnd - m_wallStart),
+        cpuEnd - m_cpuStart,
+        std::hash<std::thread::id>()(std::this_thread::get_id())
+    };
+    for (const auto& listener : m_profiler->m_listeners) {
+        listener(span);
+    }
+    if (m_profiler->m_keepSpans)
+    {
+        std::lock_guard lock(m_profiler->m_spansMutex);
+        m_profiler->m_spans.push_back(std::move(span));
+    }
+}
+
+VSProfiler::VSProfiler(bool keepSpans)
+    : m_creationTime(Clock::now()), m_systemCreationTime(std::chrono::system_clock::now()), m_keepSpans(keepSpans)
+{}
+
+void VSProfiler::addListener(Listener listener)
+{
+    m_listeners.push_back(std::move(listener));
+}
+
+auto VSProfiler::spans() const -> const std::vector<Span>&
+{
+    return m_spans;
+}
+
+auto VSProfiler::systemStart() const -> std::chrono::system_clock::time_point
+{
+    return m_systemCreationTime;
+}
+
+auto VSProfiler::processCpuTime() -> Duration
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user)) {
+        return Duration::zero();
+    }
+    auto toHundredsOfNanoseconds = [](const FILETIME& time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return Duration((toHundredsOfNanoseconds(kernel) + toHundredsOfNanoseconds(user)) / 10);
+#else
+    timespec time{};
+    if (clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &time) != 0) {
+        return Duration::zero();
+    }
+    return std::chrono::duration_cast<Duration>(std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec));
+#endif
+}
+
+auto VSProfiler::threadCpuTime() -> Duration
+{
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) {
+        return Duration::zero();
+    }
+    auto toHundredsOfNanoseconds = [](const FILETIME& time) {
+        return (static_cast<unsigned long long>(time.dwHighDateTime) << 32) | time.dwLowDateTime;
+    };
+    return Duration((toHundredsOfNanoseconds(kernel) + toHundredsOfNanoseconds(user)) / 10);
+#else
+    timespec time{};
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time) != 0) {
+        return Duration::zero();
+    }
+    return std::chrono::duration_cast<Duration>(std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec));
+#endif
+}
+
+void writeTimingsReport(std::ostream& stream, const std::vector<VSProfiler::Span>& spans, bool json)
+{
+    struct Total
+    {
+        size_t count = 0;
+        VSProfiler::Duration wallTime{0};
+        VSProfiler::Duration cpuTime{0};
+    };
+    //Stages are reported in order of their first appearance.
+    std::vector<std::string> stageOrder;
+    std::map<std::string, Total> totals;
+    for (const auto& span : spans)
+    {
+        auto [total, inserted] = totals.try_emplace(span.stage);
+        if (inserted) {
+            stageOrder.push_back(span.stage);
+        }
+        ++total->second.count;
+        total->second.wallTime += span.wallTime;
+        total->second.cpuTime += span.cpuTime;
+    }
+    auto milliseconds = [](VSProfiler::Duration duration) {
+        return duration.count() / 1000.0;
+    };
+
+    auto flags = stream.flags();
+    auto precision = stream.precision();
+    stream << std::fixed << std::setprecision(3);
+    if (json)
+    {
+        stream << "{\"spans\":[";
+        for (size_t i = 0; i < spans.size(); ++i)
+        {
+            const auto& span = spans[i];
+            stream << (i == 0 ? "" : ",")
+                   << "{\"stage\":\"" << span.stage << "\""
+                   << ",\"part\":" << span.part
+                   << ",\"start_ms\":" << milliseconds(span.start)
+                   << ",\"wall_ms\":" << milliseconds(span.wallTime)
+                   << ",\"cpu_ms\":" << milliseconds(span.cpuTime) << "}";
+        }
+        stream << "],\"totals\":{";
+        for (size_t i = 0; i < stageOrder.size(); ++i)
+        {
+            const auto& total = totals.at(stageOrder[i]);
+            stream << (i == 0 ? "" : ",")
+                   << "\"" << stageOrder[i] << "\":{"
+                   << "\"count\":" << total.count
+                   << ",\"wall_ms\":" << milliseconds(total.wallTime)
+                   << ",\"cpu_ms\":" << milliseconds(total.cpuTime) << "}";
+        }
+        stream << "}}" << std::endl;
+    }
+    else
+    {
+        constexpr int stageWidth = 24, partWidth = 6, timeWidth = 14;
+        auto writeRow = [&](const std::string& stage, const std::string& part, auto wallTime, auto cpuTime) {
+            stream << std::left << std::setw(stageWidth) << stage
+                   << std::right << std::setw(partWidth) << part
+                   << std::setw(timeWidth) << wallTime
+                   << std::setw(timeWidth) << cpuTime << std::endl;
+        };
+        writeRow("stage", "part", "wall ms", "cpu ms");
+        for (const auto& span : spans)
+        {
+            writeRow(
+                span.stage, span.part == VSProfiler::noPart ? "-" : std::to_string(span.part),
+                milliseconds(span.wallTime), milliseconds(span.cpuTime)
+            );
+        }
+        stream << std::endl;
+        writeRow("total", "count", "wall ms", "cpu ms");
+        for (const auto& stage : stageOrder)
+        {
+            const auto& total = totals.at(stage);
+            writeRow(stage, std::to_string(total.count), milliseconds(total.wallTime), milliseconds(total.cpuTime));
+        }
+    }
+    stream.flags(flags);
+    stream.precision(precision);
+}
+
+void writeChromeTrace(std::ostream& stream, const VSProfiler& profiler, const std::vector<std::string>& externalEvents)
+{
+    using namespace std::chrono;
+    auto start = duration_cast<microseconds>(profiler.systemStart().time_since_epoch());
+    auto pid = getpid();
+    //Thread hashes are too long to be shown nicely, so they are numbered in order of appearance.
+    std::map<size_t, size_t> threadNumbers;
+
+    stream << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+    bool first = true;
+    for (const auto& span : profiler.spans())
+    {
+        auto thread = threadNumbers.try_emplace(span.thread, threadNumbers.size() + 1).first->second;
+        stream << (first ? "" : ",\n")
+               << "{\"name\":\"" << span.stage << "\",\"cat\":\"lokit\",\"ph\":\"X\""
+               << ",\"ts\":" << (start + span.start).count()
+               << ",\"dur\":" << span.wallTime.count()
+               << ",\"pid\":" << pid << ",\"tid\":\"lokit-" << thread << "\""
+               << ",\"args\":{\"part\":" << span.part << ",\"cpu_us\":" << span.cpuTime.count() << "}}";
+        first = false;
+    }
+    for (auto event : externalEvents)
+    {
+        //Events may come separated by trailing commas.
+        while (!event.empty() && (event.back() == ',' || std::isspace(static_cast<unsigned char>(event.back())))) {
+            event.pop_back();
+        }
+        if (event.empty() || event.front() != '{') {
+            continue;
+        }
+        stream << (first ? "" : ",\n") << event;
+        first = false;
+    }
+    stream << "]}" << std::endl;
+}
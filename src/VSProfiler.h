@@ -0,0 +1,93 @@
+#ifndef VS_PROFILER
+#define VS_PROFILER
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <ostream>
+#include <functional>
+#include <mutex>
+
+/// @brief Records wall and CPU time of named processing stages.
+/// Spans may be recorded from several threads.
+class VSProfiler
+{
+public:
+    using Clock = std::chrono::steady_clock;
+    using Duration = std::chrono::microseconds;
+
+    /// @brief Used as part of spans which are not bound to document part.
+    static constexpr int noPart = -1;
+
+    struct Span
+    {
+        std::string stage;
+        int part;
+        /// @brief Start of span relative to profiler creation.
+        Duration start;
+        Duration wallTime;
+        /// @brief CPU time consumed by thread of span during span, so spans recorded concurrently on other threads
+        /// are not included. Work LibreOffice delegates to its own threads is not included either.
+        Duration cpuTime;
+        /// @brief Hash of id of thread span was recorded on.
+        size_t thread;
+    };
+
+    /// @brief Measures stage from construction till destruction.
+    /// Does nothing if profiler is null.
+    class Scope
+    {
+    public:
+        Scope(VSProfiler* profiler, std::string stage, int part = noPart);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+    private:
+        VSProfiler* m_profiler;
+        std::string m_stage;
+        int m_part;
+        Clock::time_point m_wallStart;
+        Duration m_cpuStart;
+    };
+
+    /// @brief Invoked on each finished span.
+    using Listener = std::function<void(const Span&)>;
+
+    /// @param keepSpans - if false, spans are only passed to listeners,
+    /// so long running processes do not accumulate them.
+    explicit VSProfiler(bool keepSpans = true);
+
+    /// @pre no spans are being recorded.
+    void addListener(Listener listener);
+
+    /// @brief Empty if spans are not kept.
+    /// @pre no spans are being recorded.
+    const std::vector<Span>& spans() const;
+    /// @brief System time of profiler creation, spans start relative to it.
+    std::chrono::system_clock::time_point systemStart() const;
+
+    /// @brief CPU time consumed by the process since its start.
+    static Duration processCpuTime();
+    /// @brief CPU time consumed by the calling thread since its start.
+    static Duration threadCpuTime();
+
+private:
+    Clock::time_point m_creationTime;
+    std::chrono::system_clock::time_point m_systemCreationTime;
+    bool m_keepSpans;
+    std::vector<Listener> m_listeners;
+    std::mutex m_spansMutex;
+    std::vector<Span> m_spans;
+};
+
+/// @brief Writes every span followed by per stage totals.
+/// @param json - if true writes report as json object, otherwise as aligned text table.
+void writeTimingsReport(std::ostream& stream, const std::vector<VSProfiler::Span>& spans, bool json);
+
+/// @brief Writes spans as Chrome Trace Event json viewable in Perfetto or chrome://tracing.
+/// @param externalEvents - already formatted trace events to merge with spans,
+/// e.g. LibreOffice profile zones. Their timestamps must be microseconds since epoch.
+void writeChromeTrace(std::ostream& stream, const VSProfiler& profiler, const std::vector<std::string>& externalEvents);
+
+#endif //VS_PROFILER
@@ -0,0 +1,73 @@
+#include "VSSearchResults.h"
+
+#include <algorithm>
+#include <cctype>
+#include <sstream>
+
+#include <boost/property_tree/ptree.hpp>
+#include <boost/property_tree/xml_parser.hpp>
+
+namespace
+{
+namespace bpt = boost::property_tree;
+
+bool containsIgnoringCase(const std::string& text, const std::string& query)
+{
+    auto found = std::search(text.begin(), text.end(), query.begin(), query.end(), [](unsigned char left, unsigned char right) {
+        return std::tolower(left) == std::tolower(right);
+    });
+    return found != text.end();
+}
+
+/// @brief Payload of paragraph is the same as its indexing xml element without text.
+/// Paragraphs of shapes are located by name of their object.
+std::string makePayload(const std::string& nodeType, int index, const std::string& objectName)
+{
+    bpt::ptree paragraph;
+    paragraph.put("<xmlattr>.node_type", nodeType);
+    paragraph.put("<xmlattr>.index", index);
+    if (nodeType == "common") {
+        paragraph.put("<xmlattr>.object_name", objectName);
+    }
+    bpt::ptree payload;
+    payload.add_child("indexing.paragraph", paragraph);
+    std::ostringstream stream;
+    bpt::write_xml(stream, payload);
+    return stream.str();
+}
+
+void findInElement(const bpt::ptree& element, const std::string& objectName, const std::string& query, std::vector<VSSearchResult>& results)
+{
+    for (const auto& [name, child] : element)
+    {
+        if (name == "paragraph")
+        {
+            std::string text = child.get_value<std::string>();
+            if (!containsIgnoringCase(text, query)) {
+                continue;
+            }
+            int index = child.get<int>("<xmlattr>.index");
+            std::string nodeType = child.get<std::string>("<xmlattr>.node_type", "writer");
+            results.push_back({index, text, makePayload(nodeType, index, objectName)});
+        }
+        else if (name == "object") {
+            findInElement(child, child.get<std::string>("<xmlattr>.name", ""), query, results);
+        }
+    }
+}
+}
+
+std::optional<std::vector<VSSearchResult>> findSearchResults(const std::string& indexingXml, const std::string& query)
+{
+    try {
+        bpt::ptree tree;
+        std::istringstream stream(indexingXml);
+        bpt::read_xml(stream, tree);
+        std::vector<VSSearchResult> results;
+        findInElement(tree.get_child("indexing"), "", query, results);
+        return results;
+    }
+    catch (const bpt::ptree_error&) {
+        return std::nullopt;
+    }
+}
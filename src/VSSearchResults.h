@@ -0,0 +1,23 @@
+#ifndef VS_SEARCH_RESULTS
+#define VS_SEARCH_RESULTS
+
+#include <string>
+#include <vector>
+#include <optional>
+
+/// @brief Paragraph of text document containing search query.
+struct VSSearchResult
+{
+    /// @brief Index of paragraph among paragraphs of document or of its object.
+    int paragraph;
+    std::string text;
+    /// @brief Xml identifying paragraph, accepted by VSLibreOffice::renderSearchResult.
+    std::string payload;
+};
+
+/// @brief Finds paragraphs containing query, ignoring case of ASCII letters, in xml written by
+/// writer_indexing_export filter: paragraphs of document body and paragraphs of its shapes and frames.
+/// @return nullopt if xml can not be parsed.
+std::optional<std::vector<VSSearchResult>> findSearchResults(const std::string& indexingXml, const std::string& query);
+
+#endif //VS_SEARCH_RESULTS
@@ -0,0 +1,63 @@
+#include "VSSystem.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <unistd.h>
+#include <sys/resource.h>
+#endif
+
+#ifdef _WIN32
+
+std::optional<size_t> residentSetSize()
+{
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return std::nullopt;
+    }
+    return counters.WorkingSetSize;
+}
+
+std::optional<size_t> peakResidentSetSize()
+{
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) {
+        return std::nullopt;
+    }
+    return counters.PeakWorkingSetSize;
+}
+
+#else
+
+std::optional<size_t> residentSetSize()
+{
+#ifdef __linux__
+    //Second field of statm is resident pages count.
+    std::ifstream statm("/proc/self/statm");
+    size_t totalPages = 0, residentPages = 0;
+    if (!(statm >> totalPages >> residentPages)) {
+        return std::nullopt;
+    }
+    return residentPages * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+    return std::nullopt;
+#endif
+}
+
+std::optional<size_t> peakResidentSetSize()
+{
+    rusage usage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return std::nullopt;
+    }
+#ifdef __APPLE__
+    return static_cast<size_t>(usage.ru_maxrss);
+#else
+    //Reported in kilobytes.
+    return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
+
+#endif
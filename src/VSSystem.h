@@ -0,0 +1,12 @@
+#ifndef VS_SYSTEM
+#define VS_SYSTEM
+
+#include <cstddef>
+#include <optional>
+
+/// @return Current resident set size of the process in bytes, nullopt if unavailable.
+std::optional<size_t> residentSetSize();
+/// @return Peak resident set size of the process in bytes, nullopt if unavailable.
+std::optional<size_t> peakResidentSetSize();
+
+#endif //VS_SYSTEM
@@ -0,0 +1,69 @@
+#include "VSThreadPool.h"
+
+#include <algorithm>
+
+VSThreadPool::VSThreadPool(unsigned threadCount)
+{
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (unsigned i = 0; i < threadCount; ++i) {
+        m_threads.emplace_back(&VSThreadPool::work, this);
+    }
+}
+
+VSThreadPool::~VSThreadPool()
+{
+    wait();
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_taskPosted.notify_all();
+    for (auto& thread : m_threads) {
+        thread.join();
+    }
+}
+
+unsigned VSThreadPool::threadCount() const
+{
+    return static_cast<unsigned>(m_threads.size());
+}
+
+void VSThreadPool::post(Task task)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+    m_taskPosted.notify_one();
+}
+
+void VSThreadPool::wait()
+{
+    std::unique_lock lock(m_mutex);
+    m_tasksDone.wait(lock, [this] { return m_tasks.empty() && m_runningTasks == 0; });
+}
+
+void VSThreadPool::work()
+{
+    std::unique_lock lock(m_mutex);
+    for (;;)
+    {
+        m_taskPosted.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+        if (m_tasks.empty()) {
+            //Stopping.
+            return;
+        }
+        Task task = std::move(m_tasks.front());
+        m_tasks.pop_front();
+        ++m_runningTasks;
+        lock.unlock();
+        task();
+        lock.lock();
+        --m_runningTasks;
+        if (m_tasks.empty() && m_runningTasks == 0) {
+            m_tasksDone.notify_all();
+        }
+    }
+}
@@ -0,0 +1,42 @@
+#ifndef VS_THREAD_POOL
+#define VS_THREAD_POOL
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/// @brief Fixed count of threads executing posted tasks in order of posting.
+class VSThreadPool
+{
+public:
+    using Task = std::function<void()>;
+
+    /// @param threadCount - if 0, hardware concurrency is used.
+    explicit VSThreadPool(unsigned threadCount = 0);
+    VSThreadPool(const VSThreadPool&) = delete;
+    VSThreadPool& operator=(const VSThreadPool&) = delete;
+    /// @brief Waits till all posted tasks are executed.
+    ~VSThreadPool();
+
+    unsigned threadCount() const;
+
+    void post(Task task);
+    /// @brief Blocks till all posted tasks are executed.
+    void wait();
+
+private:
+    void work();
+
+    std::vector<std::thread> m_threads;
+    std::mutex m_mutex;
+    std::condition_variable m_taskPosted;
+    std::condition_variable m_tasksDone;
+    std::deque<Task> m_tasks;
+    size_t m_runningTasks = 0;
+    bool m_stopping = false;
+};
+
+#endif //VS_THREAD_POOL
@@ -0,0 +1,105 @@
+#include "VSUserProfile.h"
+
+#include <cassert>
+#include <fstream>
+
+#include <boost/filesystem/operations.hpp>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+namespace
+{
+namespace bfs = boost::filesystem;
+
+/// @brief Directory profiles are created in, tmpfs on Linux, so profile is never read from disk.
+bfs::path temporaryRoot()
+{
+#ifndef _WIN32
+    const bfs::path sharedMemory = "/dev/shm";
+    boost::system::error_code error;
+    if (bfs::is_directory(sharedMemory, error) && access(sharedMemory.c_str(), W_OK) == 0) {
+        return sharedMemory;
+    }
+#endif
+    return bfs::temp_directory_path();
+}
+
+/// @brief Copies by streams, since some boost versions fail copy_file between file systems, e.g. disk and tmpfs.
+void copyFile(const bfs::path& from, const bfs::path& to)
+{
+    std::ifstream source(from.string(), std::ios::binary);
+    std::ofstream target(to.string(), std::ios::binary);
+    //Streaming of empty buffer sets failbit, so empty files are only created.
+    if (source && source.peek() != std::ifstream::traits_type::eof()) {
+        target << source.rdbuf();
+    }
+    if (!source || !target) {
+        throw bfs::filesystem_error("Unable to copy file", from, to, boost::system::errc::make_error_code(boost::system::errc::io_error));
+    }
+}
+}
+
+VSUserProfile::~VSUserProfile()
+{
+    remove();
+}
+
+auto VSUserProfile::createFromTemplate(const Path& templateDir) -> std::optional<Error>
+{
+    assert(!isCreated());
+    boost::system::error_code error;
+    if (!bfs::is_directory(bfs::path(templateDir) / "user", error)) {
+        return Error("Profile template " + templateDir + " does not contain user directory");
+    }
+    bfs::path profile;
+    try {
+        profile = temporaryRoot() / bfs::unique_path("lokit-profile-%%%%-%%%%-%%%%");
+        bfs::create_directories(profile);
+    }
+    catch (const bfs::filesystem_error& e) {
+        return Error("Unable to create user profile: " + std::string(e.what()));
+    }
+    m_path = profile.generic_string();
+    try {
+        for (bfs::recursive_directory_iterator it(templateDir), end; it != end; ++it)
+        {
+            auto target = profile / bfs::relative(it->path(), templateDir);
+            if (bfs::is_directory(it->path())) {
+                bfs::create_directories(target);
+            }
+            //Lock is left by office which has not exited cleanly, it would make office think profile is in use.
+            else if (it->path().filename() != ".lock") {
+                copyFile(it->path(), target);
+            }
+        }
+    }
+    catch (const bfs::filesystem_error& e)
+    {
+        remove();
+        return Error("Unable to copy profile template " + templateDir + ": " + e.what());
+    }
+    return std::nullopt;
+}
+
+void VSUserProfile::remove()
+{
+    if (!isCreated()) {
+        return;
+    }
+    boost::system::error_code error;
+    bfs::remove_all(m_path, error);
+    m_path.clear();
+}
+
+bool VSUserProfile::isCreated() const
+{
+    return !m_path.empty();
+}
+
+auto VSUserProfile::path() const -> const Path&
+{
+    assert(isCreated());
+    return m_path;
+}
@@ -0,0 +1,38 @@
+#ifndef VS_USER_PROFILE
+#define VS_USER_PROFILE
+
+#include <optional>
+
+#include "VSLibreOffice.h"
+
+/// @brief Private LibreOffice user profile copied from prepared template,
+/// so LibreOffice neither creates nor migrates profile on start.
+/// Profile is removed on destruction.
+class VSUserProfile
+{
+public:
+    using Path = VSLibreOffice::Path;
+    using Error = VSLibreOffice::Error;
+
+    VSUserProfile() = default;
+    VSUserProfile(const VSUserProfile&) = delete;
+    VSUserProfile& operator=(const VSUserProfile&) = delete;
+    /// @brief Removes profile if created.
+    ~VSUserProfile();
+
+    /// @brief Copies template to new directory in memory backed file system if available,
+    /// otherwise in temporary directory.
+    /// @param templateDir - profile previously passed to LibreOffice, i.e. containing user directory.
+    /// @pre is not created
+    std::optional<Error> createFromTemplate(const Path& templateDir);
+    /// @pre office using profile is deinited
+    void remove();
+    bool isCreated() const;
+    /// @pre is created
+    const Path& path() const;
+
+private:
+    Path m_path;
+};
+
+#endif //VS_USER_PROFILE
@@ -16,10 +16,10 @@ size_t permutate(ForwardIterator first, ForwardIterator last,
     assert(permutationSize != 0);
     //all unique
     assert(
-        std::unordered_set<std::iterator_traits<PermutationForwardIterator>::value_type>(
+        std::unordered_set<typename std::iterator_traits<PermutationForwardIterator>::value_type>(
             permutationFirst,
             std::next(permutationFirst, permutationSize)
-            ).size() == permutationSize
+            ).size() == static_cast<size_t>(permutationSize)
     );
     //all in range [0, permutationSize)
     assert(
@@ -0,0 +1,78 @@
+#include "VSWatchdog.h"
+
+#include <cassert>
+#include <utility>
+
+VSWatchdog::Scope::Scope(VSWatchdog* watchdog, std::string stage, std::optional<std::chrono::milliseconds> timeout, int part)
+    : m_watchdog(timeout ? watchdog : nullptr)
+{
+    if (m_watchdog) {
+        m_watchdog->arm(std::move(stage), part, *timeout);
+    }
+}
+
+VSWatchdog::Scope::~Scope()
+{
+    if (m_watchdog) {
+        m_watchdog->disarm();
+    }
+}
+
+VSWatchdog::VSWatchdog(TimeoutHandler handler)
+    : m_handler(std::move(handler)), m_thread(&VSWatchdog::watch, this)
+{}
+
+VSWatchdog::~VSWatchdog()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stopping = true;
+    }
+    m_changed.notify_all();
+    m_thread.join();
+}
+
+void VSWatchdog::arm(std::string stage, int part, std::chrono::milliseconds timeout)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        assert(!m_stage);
+        m_stage = Stage{std::move(stage), part, timeout, std::chrono::steady_clock::now() + timeout};
+    }
+    m_changed.notify_all();
+}
+
+void VSWatchdog::disarm()
+{
+    {
+        std::lock_guard lock(m_mutex);
+        m_stage.reset();
+    }
+    m_changed.notify_all();
+}
+
+void VSWatchdog::watch()
+{
+    std::unique_lock lock(m_mutex);
+    for (;;)
+    {
+        m_changed.wait(lock, [this] { return m_stopping || m_stage; });
+        if (m_stopping) {
+            return;
+        }
+        auto deadline = m_stage->deadline;
+        //Woken up early if stage finishes or watchdog stops.
+        bool isChanged = m_changed.wait_until(lock, deadline, [&] {
+            return m_stopping || !m_stage || m_stage->deadline != deadline;
+        });
+        if (isChanged) {
+            continue;
+        }
+        //Stage is reported once, even if handler returns.
+        Stage expired = std::move(*m_stage);
+        m_stage.reset();
+        lock.unlock();
+        m_handler(expired.name, expired.part, expired.timeout);
+        lock.lock();
+    }
+}
@@ -0,0 +1,65 @@
+#ifndef VS_WATCHDOG
+#define VS_WATCHDOG
+
+#include <string>
+#include <optional>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#include "VSProfiler.h"
+
+/// @brief Detects stage running longer than its timeout, e.g. LibreOffice call spinning on pathological document.
+/// Calls to LibreOffice can not be interrupted, so handler is expected to abort the job, e.g. by exiting process.
+/// Watches one stage at a time, stages are expected to run on single thread.
+class VSWatchdog
+{
+public:
+    /// @brief Invoked on watchdog thread while stage which exceeded its timeout is still running.
+    using TimeoutHandler = std::function<void(const std::string& stage, int part, std::chrono::milliseconds timeout)>;
+
+    /// @brief Watches stage from construction till destruction.
+    /// Does nothing if watchdog is null or timeout is not set.
+    class Scope
+    {
+    public:
+        Scope(VSWatchdog* watchdog, std::string stage, std::optional<std::chrono::milliseconds> timeout, int part = VSProfiler::noPart);
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+        ~Scope();
+
+    private:
+        VSWatchdog* m_watchdog;
+    };
+
+    explicit VSWatchdog(TimeoutHandler handler);
+    VSWatchdog(const VSWatchdog&) = delete;
+    VSWatchdog& operator=(const VSWatchdog&) = delete;
+    /// @brief Stops watching, handler is not invoked afterwards.
+    ~VSWatchdog();
+
+private:
+    struct Stage
+    {
+        std::string name;
+        int part;
+        std::chrono::milliseconds timeout;
+        std::chrono::steady_clock::time_point deadline;
+    };
+
+    /// @pre no stage is watched
+    void arm(std::string stage, int part, std::chrono::milliseconds timeout);
+    void disarm();
+    void watch();
+
+    TimeoutHandler m_handler;
+    std::mutex m_mutex;
+    std::condition_variable m_changed;
+    std::optional<Stage> m_stage;
+    bool m_stopping = false;
+    std::thread m_thread;
+};
+
+#endif //VS_WATCHDOG
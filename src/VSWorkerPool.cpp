@@ -0,0 +1,341 @@
+#include "VSWorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <utility>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+int VSWorkerPool::s_workerReportsFd = -1;
+unsigned VSWorkerPool::s_workerIndex = 0;
+
+bool VSWorkerPool::isSupported()
+{
+#ifdef _WIN32
+    return false;
+#else
+    return true;
+#endif
+}
+
+#ifdef _WIN32
+
+VSWorkerPool::VSWorkerPool(unsigned, Worker, CrashHandler)
+{
+    assert(isSupported());
+}
+
+VSWorkerPool::~VSWorkerPool() = default;
+
+void VSWorkerPool::process(const std::string&) {}
+
+void VSWorkerPool::finish() {}
+
+void VSWorkerPool::abortDocument(const std::string&, const std::string&)
+{
+    assert(isSupported());
+    std::abort();
+}
+
+#else
+
+namespace
+{
+/// @brief Writes whole data, retrying interrupted and partial writes.
+bool writeAll(int fd, const std::string& data)
+{
+    size_t written = 0;
+    while (written < data.size())
+    {
+        ssize_t result = write(fd, data.data() + written, data.size() - written);
+        if (result < 0)
+        {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    return true;
+}
+
+std::string describeExit(int status)
+{
+    if (WIFSIGNALED(status)) {
+        return "worker killed by signal " + std::to_string(WTERMSIG(status)) + " (" + strsignal(WTERMSIG(status)) + ")";
+    }
+    return "worker exited with code " + std::to_string(WEXITSTATUS(status));
+}
+}
+
+VSWorkerPool::VSWorkerPool(unsigned workerCount, Worker worker, CrashHandler crashHandler)
+    : m_worker(std::move(worker)), m_crashHandler(std::move(crashHandler)), m_processes(workerCount)
+{
+    assert(isSupported());
+    //Writing to pipe of exited worker must fail instead of killing current process.
+    std::signal(SIGPIPE, SIG_IGN);
+    if (pipe(m_reportsFd) != 0) {
+        std::cerr << "Unable to create pipe: " << std::strerror(errno) << std::endl;
+        m_processes.clear();
+        return;
+    }
+    fcntl(m_reportsFd[0], F_SETFL, fcntl(m_reportsFd[0], F_GETFL) | O_NONBLOCK);
+    for (unsigned i = 0; i < m_processes.size(); ++i) {
+        spawn(i);
+    }
+}
+
+VSWorkerPool::~VSWorkerPool()
+{
+    finish();
+    for (int fd : m_reportsFd)
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+}
+
+void VSWorkerPool::process(const std::string& document)
+{
+    assert(!m_isFinished);
+    for (;;)
+    {
+        reapExited();
+        if (!hasLiveWorkers()) {
+            m_crashHandler(document, "crash", "no workers left");
+            return;
+        }
+        for (auto& process : m_processes)
+        {
+            if (process.pid < 0 || process.document) {
+                continue;
+            }
+            //Worker exited meanwhile, it is reaped on next iteration.
+            if (!writeAll(process.documentsFd, document + "\n")) {
+                continue;
+            }
+            process.document = document;
+            return;
+        }
+        //Exits are noticed at least each period.
+        constexpr int reapPeriodMilliseconds = 200;
+        readReports(reapPeriodMilliseconds);
+    }
+}
+
+void VSWorkerPool::finish()
+{
+    if (m_isFinished) {
+        return;
+    }
+    m_isFinished = true;
+    //Workers exit once they read all passed documents.
+    for (auto& process : m_processes)
+    {
+        if (process.documentsFd >= 0)
+        {
+            close(process.documentsFd);
+            process.documentsFd = -1;
+        }
+    }
+    for (unsigned i = 0; i < m_processes.size(); ++i)
+    {
+        if (m_processes[i].pid < 0) {
+            continue;
+        }
+        int status = 0;
+        while (waitpid(m_processes[i].pid, &status, 0) < 0 && errno == EINTR) {}
+        //Reports of the last documents may be still in pipe.
+        readReports(0);
+        handleExit(i, status, false);
+    }
+}
+
+void VSWorkerPool::abortDocument(const std::string& cause, const std::string& reason)
+{
+    assert(s_workerReportsFd >= 0);
+    //Report is shorter than PIPE_BUF, so it is written at once and not interleaved with reports of other workers.
+    constexpr size_t maxReasonSize = 400;
+    std::string line = reason.substr(0, maxReasonSize);
+    std::replace_if(line.begin(), line.end(), [](char c) { return c == '\n' || c == '\r' || c == '\t'; }, ' ');
+    writeAll(s_workerReportsFd, std::to_string(s_workerIndex) + "\t" + cause + "\t" + line + "\n");
+    //Threads of worker may be blocked in LibreOffice, so nothing is destroyed.
+    _exit(EXIT_FAILURE);
+}
+
+bool VSWorkerPool::spawn(unsigned index)
+{
+    int documentsFd[2];
+    if (pipe(documentsFd) != 0) {
+        std::cerr << "Unable to create pipe: " << std::strerror(errno) << std::endl;
+        return false;
+    }
+    //Flushed, so buffered output is not written by both processes.
+    std::cout.flush();
+    pid_t pid = fork();
+    if (pid < 0)
+    {
+        std::cerr << "Unable to fork worker: " << std::strerror(errno) << std::endl;
+        close(documentsFd[0]);
+        close(documentsFd[1]);
+        return false;
+    }
+    if (pid == 0)
+    {
+        close(documentsFd[1]);
+        runWorker(index, documentsFd[0]);
+    }
+    close(documentsFd[0]);
+    m_processes[index].pid = pid;
+    m_processes[index].documentsFd = documentsFd[1];
+    m_processes[index].document.reset();
+    m_processes[index].abort.reset();
+    return true;
+}
+
+void VSWorkerPool::runWorker(unsigned index, int documentsFd)
+{
+    //Pipes of other workers are closed, so they get end of file when current process closes them.
+    for (const auto& process : m_processes)
+    {
+        if (process.documentsFd >= 0) {
+            close(process.documentsFd);
+        }
+    }
+    close(m_reportsFd[0]);
+    s_workerReportsFd = m_reportsFd[1];
+    s_workerIndex = index;
+    std::signal(SIGPIPE, SIG_DFL);
+    if (!m_worker.start(index + 1)) {
+        std::cout.flush();
+        _exit(EXIT_FAILURE);
+    }
+    FILE* documents = fdopen(documentsFd, "r");
+    const std::string report = std::to_string(index) + "\n";
+    char* line = nullptr;
+    size_t capacity = 0;
+    for (ssize_t length; (length = getline(&line, &capacity, documents)) > 0;)
+    {
+        std::string document(line, static_cast<size_t>(length));
+        if (document.back() == '\n') {
+            document.pop_back();
+        }
+        m_worker.process(document);
+        writeAll(m_reportsFd[1], report);
+    }
+    std::free(line);
+    m_worker.stop();
+    std::cout.flush();
+    //Destructors of objects of parent process must not run in worker.
+    _exit(EXIT_SUCCESS);
+}
+
+void VSWorkerPool::readReports(int timeoutMilliseconds)
+{
+    pollfd reports{m_reportsFd[0], POLLIN, 0};
+    if (poll(&reports, 1, timeoutMilliseconds) <= 0) {
+        return;
+    }
+    //Reports are shorter than PIPE_BUF, so they are never interleaved.
+    char buffer[512];
+    std::string pending;
+    for (ssize_t length; (length = read(m_reportsFd[0], buffer, sizeof(buffer))) > 0;) {
+        pending.append(buffer, static_cast<size_t>(length));
+    }
+    size_t start = 0;
+    for (size_t end; (end = pending.find('\n', start)) != std::string::npos; start = end + 1)
+    {
+        //Report is index of worker, followed by cause and reason if document is aborted.
+        std::string report = pending.substr(start, end - start);
+        size_t causeStart = report.find('\t');
+        unsigned index = static_cast<unsigned>(std::stoul(report.substr(0, causeStart)));
+        if (index >= m_processes.size()) {
+            continue;
+        }
+        if (causeStart == std::string::npos) {
+            m_processes[index].document.reset();
+        }
+        else
+        {
+            size_t reasonStart = report.find('\t', causeStart + 1);
+            m_processes[index].abort.emplace(
+                report.substr(causeStart + 1, reasonStart - causeStart - 1),
+                reasonStart == std::string::npos ? std::string() : report.substr(reasonStart + 1)
+            );
+        }
+    }
+}
+
+void VSWorkerPool::reapExited()
+{
+    int status = 0;
+    for (pid_t pid; (pid = waitpid(-1, &status, WNOHANG)) > 0;)
+    {
+        //Document may be reported as processed right before exit.
+        readReports(0);
+        for (unsigned i = 0; i < m_processes.size(); ++i)
+        {
+            if (m_processes[i].pid == pid) {
+                handleExit(i, status, true);
+            }
+        }
+    }
+}
+
+void VSWorkerPool::handleExit(unsigned index, int status, bool respawn)
+{
+    auto& process = m_processes[index];
+    process.pid = -1;
+    if (process.documentsFd >= 0)
+    {
+        close(process.documentsFd);
+        process.documentsFd = -1;
+    }
+    if (!process.document)
+    {
+        if (!m_isFinished) {
+            std::cerr << "Worker " << index + 1 << " stopped: " << describeExit(status) << std::endl;
+        }
+        //Worker which can not start is not replaced, it would fail again.
+        return;
+    }
+    auto document = std::move(*process.document);
+    process.document.reset();
+    auto abort = std::move(process.abort);
+    process.abort.reset();
+    if (abort) {
+        m_crashHandler(document, abort->first, abort->second);
+    }
+    else {
+        m_crashHandler(document, "crash", describeExit(status));
+    }
+    if (respawn) {
+        spawn(index);
+    }
+}
+
+bool VSWorkerPool::hasLiveWorkers() const
+{
+    for (const auto& process : m_processes)
+    {
+        if (process.pid >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif
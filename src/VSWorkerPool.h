@@ -0,0 +1,85 @@
+#ifndef VS_WORKER_POOL
+#define VS_WORKER_POOL
+
+#include <string>
+#include <vector>
+#include <optional>
+#include <functional>
+#include <utility>
+
+/// @brief Processes documents in worker processes forked from current process,
+/// so workers share LibreOffice pre-initialized before pool creation.
+/// Worker which exits while processing document is replaced by new one.
+/// Worker may abort document it can not finish, e.g. hanging in LibreOffice, the same way.
+/// Supported only on POSIX systems.
+class VSWorkerPool
+{
+public:
+    /// @brief Functions invoked in worker process.
+    struct Worker
+    {
+        /// @brief Invoked after fork with worker number starting from 1, false exits worker.
+        std::function<bool(unsigned number)> start;
+        std::function<void(const std::string& document)> process;
+        /// @brief Invoked when there are no documents left.
+        std::function<void()> stop;
+    };
+    /// @brief Invoked in current process when document could not be processed because its worker exited.
+    /// @param cause - "crash" or cause passed to abortDocument.
+    using CrashHandler = std::function<void(const std::string& document, const std::string& cause, const std::string& reason)>;
+
+    static bool isSupported();
+
+    /// @pre isSupported()
+    VSWorkerPool(unsigned workerCount, Worker worker, CrashHandler crashHandler);
+    VSWorkerPool(const VSWorkerPool&) = delete;
+    VSWorkerPool& operator=(const VSWorkerPool&) = delete;
+    /// @brief Finishes pool.
+    ~VSWorkerPool();
+
+    /// @brief Passes document to idle worker, blocks till there is one.
+    void process(const std::string& document);
+    /// @brief Waits till all passed documents are processed and workers exit.
+    void finish();
+
+    /// @brief Exits worker without finishing its document, which is passed to crash handler with cause and reason.
+    /// Line breaks and tabs of reason are replaced by spaces. May be called from any thread of worker.
+    /// @pre called in worker process
+    [[noreturn]] static void abortDocument(const std::string& cause, const std::string& reason);
+
+private:
+    struct Process
+    {
+        int pid = -1;
+        /// @brief Write end of pipe passing documents to worker.
+        int documentsFd = -1;
+        /// @brief Document being processed, not set if worker is idle.
+        std::optional<std::string> document;
+        /// @brief Cause and reason of document aborted by worker.
+        std::optional<std::pair<std::string, std::string>> abort;
+    };
+
+    /// @return false if worker could not be forked.
+    bool spawn(unsigned index);
+    [[noreturn]] void runWorker(unsigned index, int documentsFd);
+    /// @brief Marks workers which reported processed documents as idle and records aborted documents.
+    /// @param timeoutMilliseconds - time to wait for first report, -1 is infinite.
+    void readReports(int timeoutMilliseconds);
+    /// @brief Reports and replaces workers which exited.
+    void reapExited();
+    void handleExit(unsigned index, int status, bool respawn);
+    bool hasLiveWorkers() const;
+
+    Worker m_worker;
+    CrashHandler m_crashHandler;
+    std::vector<Process> m_processes;
+    /// @brief Pipe workers write their indices to after each processed document.
+    int m_reportsFd[2] = {-1, -1};
+    bool m_isFinished = false;
+
+    //Set in worker process, so documents can be aborted from any of its threads.
+    static int s_workerReportsFd;
+    static unsigned s_workerIndex;
+};
+
+#endif //VS_WORKER_POOL
@@ -2,16 +2,30 @@
 #include <functional>
 #include <cassert>
 #include <charconv>
+#include <fstream>
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <chrono>
 
 #include "VSLibreOffice.h"
+#include "VSMetrics.h"
+#include "VSMemoryTrimmer.h"
+#include "VSImageExporter.h"
+#include "VSFilterCatalog.h"
+#include "VSInstalledFilters.h"
+#include "VSUserProfile.h"
+#include "VSWorkerPool.h"
+#include "VSSearchResults.h"
+#include "VSWatchdog.h"
+#include "VSHash.h"
 
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/parsers.hpp>
 #include <boost/program_options/value_semantic.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <boost/filesystem/path.hpp>
-
-#include <QImage>
+#include <boost/filesystem/operations.hpp>
 
 #define LOK_USE_UNSTABLE_API
 #include <LibreOfficeKit.hxx>
@@ -28,6 +42,10 @@
 
 namespace bpo = boost::program_options;
 
+constexpr int invalidArgumentErrorReturnCode = 1;
+constexpr int libreOfficeErrorReturnCode = invalidArgumentErrorReturnCode + 1;
+constexpr int timeoutErrorReturnCode = libreOfficeErrorReturnCode + 1;
+
 template<typename T>
 std::optional<T> tryGetOptionAs(const bpo::variables_map& options, const std::string& optionName)
 {
@@ -39,16 +57,602 @@ std::optional<T> tryGetOptionAs(const bpo::variables_map& options, const std::st
     }
 }
 
+/// @brief Reads timeout option given in seconds.
+/// @return false if timeout is not positive, which is reported.
+bool getTimeoutOption(const bpo::variables_map& options, const std::string& optionName, std::optional<std::chrono::milliseconds>& timeout)
+{
+    if (auto seconds = tryGetOptionAs<double>(options, optionName))
+    {
+        if (*seconds <= 0) {
+            std::cerr << "Timeouts must be positive." << std::endl;
+            return false;
+        }
+        timeout = std::chrono::milliseconds(static_cast<long long>(*seconds * 1000));
+    }
+    return true;
+}
+
+using Resolution = VSImageExporter::Resolution;
+
+/// @brief Parses resolution in WxH format.
+/// @return nullopt if resolution is invalid, error is reported to stderr.
+std::optional<Resolution> parseResolution(const std::string& sresolution)
+{
+    try {
+        auto separatorPos = sresolution.find("x", 0);
+        if (separatorPos == std::string::npos) {
+            throw std::invalid_argument("");
+        }
+        int width = std::stoi(sresolution.substr(0, separatorPos));
+        int height = std::stoi(sresolution.substr(separatorPos + 1));
+        if (width < 0 || height < 0) {
+            throw std::out_of_range("");
+        }
+        return Resolution{width, height};
+    }
+    catch (const std::invalid_argument&)
+    {
+        std::cerr << "Invalid resolution format." << std::endl;
+    }
+    catch (const std::out_of_range&)
+    {
+        std::cerr << "Resolution is out of possible range." << std::endl;
+    }
+    return std::nullopt;
+}
+
+/// @brief Splits comma separated list, empty items are skipped.
+std::vector<std::string> splitList(const std::string& list)
+{
+    std::vector<std::string> items;
+    size_t start = 0;
+    for (;;)
+    {
+        size_t end = list.find(',', start);
+        std::string item = list.substr(start, end == std::string::npos ? std::string::npos : end - start);
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+        if (end == std::string::npos) {
+            return items;
+        }
+        start = end + 1;
+    }
+}
+
+struct Conversion
+{
+    /// @brief Extension or name of export filter.
+    std::string format;
+    /// @brief If not set, converted file is placed next to document.
+    std::optional<std::string> outputFile;
+};
+
+/// @brief Describes what has to be done with each opened document.
+struct DocumentTask
+{
+    /// @brief Performed in order on once loaded document.
+    std::vector<Conversion> conversions;
+    std::optional<std::string> exportFormat;
+    /// @brief Part is rendered once and exported in each resolution.
+    std::vector<Resolution> resolutions;
+    std::optional<std::string> tilesFormat;
+    VSImageExporter::TilePyramid tilePyramid;
+    /// @brief Text of parts is extracted from the same loaded document.
+    std::optional<boost::filesystem::path> textFile;
+    boost::filesystem::path outputDir;
+
+    bool exportsImages() const
+    {
+        return exportFormat || tilesFormat;
+    }
+    bool isEmpty() const
+    {
+        return conversions.empty() && !exportsImages() && !textFile;
+    }
+};
+
+/// @brief Reports failure to stderr and to metrics if they are collected.
+void reportFailure(VSMetrics* metrics, const std::string& cause, const std::string& message)
+{
+    std::cerr << message << std::endl;
+    if (metrics) {
+        metrics->failure(cause);
+    }
+}
+
+/// @brief Checks document can be converted to format before it is loaded, guessing its type by extension.
+/// @param format - extension or name of export filter.
+/// @param installedFilters - if set, filter must be provided by installation.
+/// @return error message if conversion is impossible.
+std::optional<std::string> checkConversion(const std::string& format, const std::string& filePath, const VSInstalledFilters* installedFilters)
+{
+    if (!VSFilterCatalog::resolve(format, VSFilterCatalog::allDocumentTypes)) {
+        return "Unknown conversion format " + format + ", expected extension or name of export filter.";
+    }
+    std::string extension = boost::filesystem::path(filePath).extension().string();
+    if (!extension.empty()) {
+        extension.erase(0, 1);
+    }
+    auto documentTypes = VSFilterCatalog::documentTypesOf(extension);
+    if (documentTypes == VSFilterCatalog::noDocumentTypes) {
+        return std::nullopt;
+    }
+    auto filter = VSFilterCatalog::resolve(format, documentTypes);
+    if (!filter) {
+        return "Document " + filePath + " can not be converted to " + format + ".";
+    }
+    if (installedFilters && !installedFilters->provides(*filter)) {
+        return "Filter " + std::string(filter->name) + " is not provided by LibreOffice installation, which does not know file type "
+            + filter->fileType + ".";
+    }
+    return std::nullopt;
+}
+
+/// @pre libreOffice is opened
+void convertDocument(VSLibreOffice& libreOffice, const std::string& filePath, const Conversion& conversion, VSMetrics* metrics)
+{
+    assert(libreOffice.isOpened());
+    auto filter = VSFilterCatalog::resolve(conversion.format, VSFilterCatalog::documentTypes(libreOffice.documentType()));
+    if (!filter) {
+        reportFailure(metrics, "format", "Document " + filePath + " can not be converted to " + conversion.format + ".");
+        return;
+    }
+    boost::filesystem::path outputPath;
+    if (conversion.outputFile) {
+        outputPath = *conversion.outputFile;
+    }
+    else
+    {
+        outputPath = filePath;
+        outputPath.replace_extension(filter->extension);
+    }
+    boost::system::error_code equivalenceError;
+    if (boost::filesystem::equivalent(outputPath, filePath, equivalenceError)) {
+        reportFailure(metrics, "save", "Converted file " + outputPath.generic_string() + " would overwrite document.");
+        return;
+    }
+    auto error = libreOffice.saveAs(outputPath.generic_string(), filter->extension);
+    if (error) {
+        reportFailure(metrics, "save", error->message());
+    }
+    else if (metrics)
+    {
+        boost::system::error_code sizeError;
+        auto size = boost::filesystem::file_size(outputPath, sizeError);
+        if (!sizeError) {
+            metrics->bytesWritten(size);
+        }
+    }
+}
+
+/// @brief Escapes string to be placed between quotes of json string.
+std::string escapeJson(const std::string& string)
+{
+    std::string result;
+    result.reserve(string.size());
+    constexpr char hexDigits[] = "0123456789abcdef";
+    for (char c : string)
+    {
+        switch (c)
+        {
+        case '"': result += "\\\""; break;
+        case '\\': result += "\\\\"; break;
+        case '\n': result += "\\n"; break;
+        case '\r': result += "\\r"; break;
+        case '\t': result += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20)
+            {
+                result += "\\u00";
+                result += hexDigits[c >> 4];
+                result += hexDigits[c & 0xF];
+            }
+            else {
+                result += c;
+            }
+        }
+    }
+    return result;
+}
+
+/// @brief Writes text of document to file: json object if file extension is .json, otherwise UTF-8 plain text.
+/// Text of presentation, spreadsheet and drawing documents is written per part: json has array of parts,
+/// plain text has parts separated by form feed. Pages of text document are not selected separately,
+/// so its text is written once: json has single text member.
+/// Selection of text is watched with timeout, like rendering.
+/// @pre libreOffice is opened
+void extractText(
+    VSLibreOffice& libreOffice, const boost::filesystem::path& textFile, VSMetrics* metrics,
+    VSWatchdog* watchdog, std::optional<std::chrono::milliseconds> timeout
+)
+{
+    assert(libreOffice.isOpened());
+    const bool json = textFile.extension() == ".json";
+    std::ofstream file(textFile.string(), std::ios::binary);
+    if (libreOffice.documentType() == LOK_DOCTYPE_TEXT)
+    {
+        std::string text;
+        {
+            VSWatchdog::Scope watch(watchdog, "getTextSelection", timeout);
+            text = libreOffice.partText();
+        }
+        if (json) {
+            file << "{\"text\":\"" << escapeJson(text) << "\"}\n";
+        }
+        else {
+            file << text;
+        }
+    }
+    else
+    {
+        if (json) {
+            file << "{\"parts\":[";
+        }
+        for (int i = 0; i < libreOffice.partCount(); ++i)
+        {
+            std::string text;
+            {
+                VSWatchdog::Scope watch(watchdog, "getTextSelection", timeout, i);
+                libreOffice.setPart(i);
+                text = libreOffice.partText();
+            }
+            if (json) {
+                file << (i == 0 ? "" : ",") << "{\"part\":" << i << ",\"text\":\"" << escapeJson(text) << "\"}";
+            }
+            else {
+                file << (i == 0 ? "" : "\f") << text;
+            }
+        }
+        if (json) {
+            file << "]}\n";
+        }
+    }
+    file.close();
+    if (!file) {
+        reportFailure(metrics, "write", "Unable to save " + textFile.generic_string());
+    }
+    else if (metrics)
+    {
+        boost::system::error_code sizeError;
+        auto size = boost::filesystem::file_size(textFile, sizeError);
+        if (!sizeError) {
+            metrics->bytesWritten(size);
+        }
+    }
+}
+
+/// @brief Name of batch mode subdirectory of document: its stem followed by hash of its absolute path
+/// as 16 hexadecimal digits, e.g. report-5c3f0e9a71d2b846, so documents of the same stem in different
+/// directories are exported to different subdirectories, also by different workers.
+std::string documentDirectoryName(const std::string& document)
+{
+    boost::filesystem::path path(document);
+    std::string absolutePath = boost::filesystem::absolute(path).lexically_normal().generic_string();
+    uint64_t hash = hashBytes(reinterpret_cast<const unsigned char*>(absolutePath.data()), absolutePath.size());
+    char digits[16];
+    auto end = std::to_chars(digits, digits + sizeof(digits), hash, 16).ptr;
+    return path.stem().string() + "-" + std::string(digits + sizeof(digits) - end, '0') + std::string(digits, end);
+}
+
+/// @brief Reads paths of documents, one per line, and passes each to function as soon as it is read,
+/// so documents written to standard input by another process are processed without waiting for its end.
+/// Empty lines are skipped.
+/// @param listPath - path to list file or "-" for standard input.
+/// @return false if list could not be opened.
+bool forEachListedDocument(const std::string& listPath, const std::function<void(const std::string&)>& function)
+{
+    std::ifstream listFile;
+    if (listPath != "-")
+    {
+        listFile.open(listPath);
+        if (!listFile) {
+            return false;
+        }
+    }
+    std::istream& list = listPath == "-" ? std::cin : listFile;
+    for (std::string line; std::getline(list, line);)
+    {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (!line.empty()) {
+            function(line);
+        }
+    }
+    return true;
+}
+
+/// @brief Finds font files in directory and its subdirectories, sorted so fonts are registered in stable order.
+/// @return nullopt if directory can not be read.
+std::optional<std::vector<std::string>> findFontFiles(const std::string& directory)
+{
+    std::vector<std::string> fontFiles;
+    boost::system::error_code error;
+    for (boost::filesystem::recursive_directory_iterator entry(directory, error), end; !error && entry != end; entry.increment(error))
+    {
+        std::string extension = entry->path().extension().string();
+        std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c) {
+            return static_cast<char>(std::tolower(c));
+        });
+        if (extension == ".ttf" || extension == ".otf" || extension == ".ttc" || extension == ".pfb" || extension == ".pfa") {
+            fontFiles.push_back(entry->path().string());
+        }
+    }
+    if (error) {
+        return std::nullopt;
+    }
+    std::sort(fontFiles.begin(), fontFiles.end());
+    return fontFiles;
+}
+
+/// @brief Parses color in #RRGGBB or RRGGBB format.
+/// @return color as 0xRRGGBB.
+std::optional<uint32_t> parseColor(const std::string& color)
+{
+    std::string digits = !color.empty() && color.front() == '#' ? color.substr(1) : color;
+    uint32_t value = 0;
+    auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+    if (digits.size() != 6 || error != std::errc() || end != digits.data() + digits.size()) {
+        return std::nullopt;
+    }
+    return value;
+}
+
+/// @brief Parses positive number of megabytes.
+std::optional<size_t> parseMegabytes(const std::string& value)
+{
+    try {
+        double megabytes = std::stod(value);
+        if (megabytes > 0) {
+            return static_cast<size_t>(megabytes * 1024 * 1024);
+        }
+    }
+    catch (const std::exception&) {}
+    return std::nullopt;
+}
+
+/// @brief Creates user profile to be used as --profile-template,
+/// letting LibreOffice create it and initialize modules used by opening of documents.
+int warmProfile(int argc, char** argv)
+{
+    bpo::options_description options;
+    options.add_options()
+        ("libre-office", bpo::value<std::string>())
+        ("profile", bpo::value<std::string>())
+        ("document", bpo::value<std::vector<std::string>>());
+    bpo::positional_options_description positionalOptions;
+    positionalOptions.add("libre-office", 1).add("profile", 1).add("document", -1);
+    bpo::variables_map optionValues;
+    try {
+        bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(positionalOptions).run(), optionValues);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    if (!optionValues.count("libre-office") || !optionValues.count("profile")) {
+        std::cerr << "Usage: lokit warm-profile PATH_TO_LIBRE_OFFICE PROFILE_DIR [DOCUMENT...]" << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    auto profile = optionValues["profile"].as<std::string>();
+    boost::system::error_code error;
+    if (boost::filesystem::exists(profile, error) && !boost::filesystem::is_empty(profile, error)) {
+        std::cerr << "Profile directory " << profile << " must be empty or not exist." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+
+    int returnCode = 0;
+    VSLibreOffice libreOffice;
+    if (auto initError = libreOffice.init(optionValues["libre-office"].as<std::string>(), profile)) {
+        std::cerr << initError->message() << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+    if (optionValues.count("document"))
+    {
+        for (const auto& document : optionValues["document"].as<std::vector<std::string>>())
+        {
+            if (auto openError = libreOffice.open(document))
+            {
+                std::cerr << openError->message() << std::endl;
+                returnCode = libreOfficeErrorReturnCode;
+            }
+            libreOffice.close();
+        }
+    }
+    //Profile is written by LibreOffice on exit.
+    libreOffice.deinit();
+    if (!boost::filesystem::is_directory(boost::filesystem::path(profile) / "user", error)) {
+        std::cerr << "LibreOffice has not created profile in " << profile << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+    std::cout << "Profile is written to " << profile << std::endl;
+    return returnCode;
+}
+
+/// @brief Renders paragraphs of text document containing query as separate images, loading document once,
+/// and writes json array describing them to stdout.
+int renderSnippets(int argc, char** argv)
+{
+    bpo::options_description options;
+    options.add_options()
+        ("libre-office", bpo::value<std::string>())
+        ("document", bpo::value<std::string>())
+        ("query", bpo::value<std::string>())
+        ("format", bpo::value<std::string>()->default_value("png"))
+        ("output-dir", bpo::value<std::string>()->default_value("."))
+        ("load-timeout", bpo::value<double>())
+        ("render-timeout", bpo::value<double>())
+        ("save-timeout", bpo::value<double>());
+    bpo::positional_options_description positionalOptions;
+    positionalOptions.add("libre-office", 1).add("document", 1);
+    bpo::variables_map optionValues;
+    try {
+        bpo::store(bpo::command_line_parser(argc, argv).options(options).positional(positionalOptions).run(), optionValues);
+    }
+    catch (std::exception& e) {
+        std::cerr << e.what() << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    auto query = tryGetOptionAs<std::string>(optionValues, "query");
+    if (!optionValues.count("libre-office") || !optionValues.count("document") || !query || query->empty()) {
+        std::cerr << "Usage: lokit snippet PATH_TO_LIBRE_OFFICE DOCUMENT --query TEXT [--format png] [--output-dir path]"
+                  << " [--load-timeout seconds] [--render-timeout seconds] [--save-timeout seconds]" << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    std::optional<std::chrono::milliseconds> loadTimeout, renderTimeout, saveTimeout;
+    if (!getTimeoutOption(optionValues, "load-timeout", loadTimeout) || !getTimeoutOption(optionValues, "render-timeout", renderTimeout)
+        || !getTimeoutOption(optionValues, "save-timeout", saveTimeout))
+    {
+        return invalidArgumentErrorReturnCode;
+    }
+    auto document = optionValues["document"].as<std::string>();
+    auto format = optionValues["format"].as<std::string>();
+    boost::filesystem::path outputDir = optionValues["output-dir"].as<std::string>();
+
+    VSLibreOffice libreOffice;
+    if (auto initError = libreOffice.init(optionValues["libre-office"].as<std::string>())) {
+        std::cerr << initError->message() << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+    //Search result payload refers to paragraph by its index in indexing xml.
+    boost::system::error_code error;
+    auto indexingPath = boost::filesystem::temp_directory_path(error) / boost::filesystem::unique_path("lokit-indexing-%%%%-%%%%.xml");
+    std::optional<VSWatchdog> watchdog;
+    if (loadTimeout || renderTimeout || saveTimeout)
+    {
+        watchdog.emplace([&](const std::string& stage, int, std::chrono::milliseconds timeout)
+        {
+            boost::system::error_code removeError;
+            boost::filesystem::remove(indexingPath, removeError);
+            std::cout.flush();
+            std::cerr << "Timeout of " << stage << " of " << document << " after " << timeout.count() << " ms" << std::endl;
+            //Main thread is blocked in LibreOffice, so nothing is destroyed.
+            std::_Exit(timeoutErrorReturnCode);
+        });
+    }
+    VSWatchdog* watchdogPtr = watchdog ? &*watchdog : nullptr;
+    std::optional<VSLibreOffice::Error> openError;
+    {
+        VSWatchdog::Scope watch(watchdogPtr, "documentLoad", loadTimeout);
+        openError = libreOffice.open(document);
+    }
+    if (openError) {
+        std::cerr << openError->message() << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+    //LibreOffice renders search results only of text documents.
+    if (libreOffice.documentType() != LOK_DOCTYPE_TEXT) {
+        std::cerr << "Snippets can be rendered only for text documents." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    auto indexingFilter = VSFilterCatalog::findByName("writer_indexing_export");
+    assert(indexingFilter);
+    std::optional<VSLibreOffice::Error> saveError;
+    {
+        VSWatchdog::Scope watch(watchdogPtr, "saveAs", saveTimeout);
+        saveError = libreOffice.saveAs(indexingPath.string(), indexingFilter->extension);
+    }
+    if (saveError)
+    {
+        //Failed save may leave partially written file.
+        boost::filesystem::remove(indexingPath, error);
+        std::cerr << saveError->message() << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+    std::string indexingXml;
+    {
+        std::ifstream file(indexingPath.string(), std::ios::binary);
+        indexingXml.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    }
+    boost::filesystem::remove(indexingPath, error);
+    auto searchResults = findSearchResults(indexingXml, *query);
+    if (!searchResults) {
+        std::cerr << "Unable to parse indexing xml of " << document << std::endl;
+        return libreOfficeErrorReturnCode;
+    }
+
+    int returnCode = 0;
+    VSImageExporter imageExporter({}, nullptr, nullptr, nullptr, [&returnCode](const std::string&, const std::string& message) {
+        std::cerr << message << std::endl;
+        returnCode = libreOfficeErrorReturnCode;
+    });
+    std::string stem = boost::filesystem::path(document).stem().string();
+    bool isFirst = true;
+    std::cout << "[";
+    for (size_t i = 0; i < searchResults->size(); ++i)
+    {
+        const auto& searchResult = (*searchResults)[i];
+        std::optional<VSLibreOffice::Bitmap> bitmap;
+        {
+            VSWatchdog::Scope watch(watchdogPtr, "renderSearchResult", renderTimeout);
+            bitmap = libreOffice.renderSearchResult(searchResult.payload);
+        }
+        if (!bitmap)
+        {
+            std::cerr << "Unable to render paragraph " << searchResult.paragraph << " of " << document << std::endl;
+            returnCode = libreOfficeErrorReturnCode;
+            continue;
+        }
+        auto imagePath = (outputDir / (stem + "_" + std::to_string(i + 1) + "." + format)).generic_string();
+        if (!imageExporter.exportBitmap(std::move(*bitmap), format, imagePath)) {
+            continue;
+        }
+        std::cout << (isFirst ? "" : ",")
+                  << "{\"image\":\"" << escapeJson(imagePath) << "\""
+                  << ",\"paragraph\":" << searchResult.paragraph
+                  << ",\"text\":\"" << escapeJson(searchResult.text) << "\"}";
+        isFirst = false;
+    }
+    std::cout << "]" << std::endl;
+    return returnCode;
+}
+
 int main(int argc, char** argv)
 {
+    if (argc > 1 && std::string(argv[1]) == "warm-profile") {
+        return warmProfile(argc - 1, argv + 1);
+    }
+    if (argc > 1 && std::string(argv[1]) == "snippet") {
+        return renderSnippets(argc - 1, argv + 1);
+    }
+
     bpo::options_description visibleOptions("Options");
     visibleOptions.add_options()
         ("help", "show help")
-        ("convert-to", bpo::value<std::string>()->value_name("format"), "convert file to specified format")
-        ("output-file", bpo::value<std::string>()->value_name("path"), "path to converted file")
+        ("profile-template", bpo::value<std::string>()->value_name("path"), "copy user profile made by warm-profile command to tmpfs and start LibreOffice with it")
+        ("font-dir", bpo::value<std::vector<std::string>>()->value_name("path")->composing(), "register fonts of directory and its subdirectories once LibreOffice is initialized, before any document is loaded; may be repeated")
+        ("list-filters", "list file types of filters provided by LibreOffice: type name, media type and conversion format exporting to it")
+        ("filter-cache", bpo::value<std::string>()->value_name("path")->default_value(VSInstalledFilters::defaultCachePath()), "file caching file types of filters provided by LibreOffice")
+        ("convert-to", bpo::value<std::string>()->value_name("formats"), "convert file to comma separated formats, extensions or names of export filters, document is loaded once")
+        ("output-file", bpo::value<std::vector<std::string>>()->value_name("path")->composing(), "path to converted file, repeated for each format in the same order")
         ("export-as-images", bpo::value<std::string>()->value_name("format"), "exports file as images")
         ("resolution", bpo::value<std::string>()->value_name("WxH")->default_value("1920x1080"), "images resolution")
-        ("output-dir", bpo::value<std::string>()->value_name("path")->default_value("."), "path to exported images");
+        ("resolutions", bpo::value<std::string>()->value_name("WxH,..."), "export images in several resolutions, part is rendered once in the largest one and downscaled")
+        ("export-as-tiles", bpo::value<std::string>()->value_name("format"), "exports each part as Deep Zoom image, tiles of every level are rendered directly")
+        ("tile-size", bpo::value<int>()->value_name("pixels")->default_value(256), "size of Deep Zoom tiles")
+        ("tile-dpi", bpo::value<double>()->value_name("dpi")->default_value(300), "resolution of the deepest Deep Zoom level")
+        ("extract-text", bpo::value<std::string>()->value_name("path"), "extract text to file, json if path ends with .json, otherwise plain text; text of presentation, spreadsheet and drawing documents is extracted per part, in plain text separated by form feed, text of text document at once; in batch mode file of that name is written to subdirectory of document in output dir")
+        ("output-dir", bpo::value<std::string>()->value_name("path")->default_value("."), "path to exported images")
+        ("memory-budget", bpo::value<std::string>()->value_name("MB"), "limit memory of images being rendered and encoded at once, images not fitting it are rendered by strips")
+        ("background", bpo::value<std::string>()->value_name("#RRGGBB"), "composite images over color and encode them without alpha, images of formats without alpha are always composited, by default over white")
+        ("pixel-format", bpo::value<std::string>()->value_name("format")->default_value("argb32"), "pixel format of images: argb32, gray8 or indexed8, 8 bit formats are composited over background")
+        ("dedup", bpo::value<std::string>()->value_name("mode")->implicit_value("link"), "encode parts rendered the same only once, duplicates are hard links (link) or listed in duplicates.json of output dir (manifest)")
+        ("supersample", bpo::value<int>()->value_name("factor")->default_value(1), "render images at factor times resolution and downscale them, antialiasing small images; 1, 2 or 4")
+        ("encode-threads", bpo::value<unsigned>()->value_name("count")->default_value(0), "count of threads encoding images, 0 is count of processors")
+        ("batch", bpo::value<std::string>()->value_name("path"), "process documents listed in file, one per line, - for stdin; images of each document are exported to subdirectory of output dir named after document stem and hash of its absolute path, e.g. report-5c3f0e9a71d2b846")
+        ("load-timeout", bpo::value<double>()->value_name("seconds"), "abort document loading longer than seconds; lokit exits with code 3, in batch mode worker processing the document is replaced, documents are processed by one worker if workers are not specified")
+        ("render-timeout", bpo::value<double>()->value_name("seconds"), "abort document whose part, tile, snippet or extracted text renders longer than seconds, the same way as load timeout")
+        ("save-timeout", bpo::value<double>()->value_name("seconds"), "abort document whose conversion saves longer than seconds, the same way as load timeout")
+        ("workers", bpo::value<unsigned>()->value_name("count"), "batch mode: process documents in count processes forked from preinitialized LibreOffice, crashed or timed out worker is replaced; POSIX only")
+        ("progress", "report progress of document loading to stderr")
+        ("timings", bpo::value<std::string>()->value_name("format")->implicit_value("text"), "report wall time and CPU time of the thread running each stage, format is text or json")
+        ("trace", bpo::value<std::string>()->value_name("path"), "write Chrome Trace Event file with lokit stages and LibreOffice profile zones")
+        ("metrics-file", bpo::value<std::string>()->value_name("path"), "write metrics in Prometheus text format, in batch mode updated after each document")
+        ("trim-after", bpo::value<int>()->value_name("count"), "batch mode: release LibreOffice caches after each count documents")
+        ("trim-idle", bpo::value<double>()->value_name("seconds"), "batch mode: release LibreOffice caches when no document arrives for seconds")
+        ("trim-rss", bpo::value<std::string>()->value_name("MB"), "batch mode: release LibreOffice caches after document if resident set size exceeds MB")
+        ("trim-target", bpo::value<int>()->value_name("target")->default_value(1000), "target passed to trimMemory, >= 1000 is maximal saving");
 
     bpo::options_description options;
     options.add_options()
@@ -63,7 +667,6 @@ int main(int argc, char** argv)
         return tryGetOptionAs<std::string>(optionValues, name);
     };
 
-    constexpr int invalidArgumentErrorReturnCode = 1;
     try {
         bpo::store(bpo::command_line_parser(argc, argv).options(options.add(visibleOptions)).positional(positionalOptions).run(), optionValues);
     }
@@ -72,125 +675,642 @@ int main(int argc, char** argv)
         return invalidArgumentErrorReturnCode;
     }
 
-    if (argc < 2 || getOptionAsString("help")) {
+    if (argc < 2 || optionValues.count("help")) {
         std::cout << "Usage: lokit PATH_TO_LIBRE_OFFICE PATH_TO_FILE [--options]" << std::endl;
+        std::cout << "       lokit PATH_TO_LIBRE_OFFICE --batch LIST [--options]" << std::endl;
+        std::cout << "       lokit warm-profile PATH_TO_LIBRE_OFFICE PROFILE_DIR [DOCUMENT...]" << std::endl;
+        std::cout << "       lokit snippet PATH_TO_LIBRE_OFFICE DOCUMENT --query TEXT [--format png] [--output-dir path] [--*-timeout seconds]" << std::endl;
         std::cout << visibleOptions << std::endl;
     }
 
-    VSLibreOffice libreOffice;
-    constexpr int libreOfficeErrorReturnCode = invalidArgumentErrorReturnCode + 1;
-    auto tryInitLibreOfficeAndOpenFile = [&]() -> std::optional<VSLibreOffice::Error>
+    bool jsonTimings = false;
+    if (auto timingsFormat = getOptionAsString("timings"))
     {
-        if (!libreOffice.isInited())
+        if (*timingsFormat != "text" && *timingsFormat != "json") {
+            std::cerr << "Invalid timings format " << *timingsFormat << ", expected text or json." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        jsonTimings = *timingsFormat == "json";
+    }
+    auto tracePath = getOptionAsString("trace");
+    auto metricsPath = getOptionAsString("metrics-file");
+    auto batchListPath = getOptionAsString("batch");
+    if (batchListPath && optionValues.count("output-file")) {
+        std::cerr << "Output file can not be specified in batch mode." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    auto workerCount = tryGetOptionAs<unsigned>(optionValues, "workers");
+    if (workerCount)
+    {
+        if (!VSWorkerPool::isSupported()) {
+            std::cerr << "Workers are not supported on this platform." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        if (!batchListPath || *workerCount == 0) {
+            std::cerr << "Positive workers count can be specified only in batch mode." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        if (getOptionAsString("timings") || tracePath) {
+            std::cerr << "Timings and trace can not be collected from workers." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+
+    //Directories are scanned once, workers only register found fonts.
+    std::vector<std::string> fontFiles;
+    if (auto fontDirs = tryGetOptionAs<std::vector<std::string>>(optionValues, "font-dir"))
+    {
+        for (const auto& fontDir : *fontDirs)
         {
-            auto libreOfficePath = getOptionAsString("libre-office");
-            if (!libreOfficePath) {
-                return VSLibreOffice::Error("Path to libre office installation must be provided to perform conversion or exporting");
-            }
-            auto error = libreOffice.init(*libreOfficePath);
-            if (error) {
-                return error;
+            auto found = findFontFiles(fontDir);
+            if (!found) {
+                std::cerr << "Unable to read font directory " << fontDir << "." << std::endl;
+                return invalidArgumentErrorReturnCode;
             }
+            fontFiles.insert(fontFiles.end(), found->begin(), found->end());
         }
-        if (!libreOffice.isOpened())
+    }
+
+    //Calls to LibreOffice can not be interrupted, so document exceeding timeout aborts process.
+    std::optional<std::chrono::milliseconds> loadTimeout, renderTimeout, saveTimeout;
+    if (!getTimeoutOption(optionValues, "load-timeout", loadTimeout) || !getTimeoutOption(optionValues, "render-timeout", renderTimeout)
+        || !getTimeoutOption(optionValues, "save-timeout", saveTimeout))
+    {
+        return invalidArgumentErrorReturnCode;
+    }
+    //Aborting the process would drop the rest of the list, so documents of batch are aborted in worker,
+    //which is replaced.
+    if ((loadTimeout || renderTimeout || saveTimeout) && batchListPath && !workerCount)
+    {
+        if (!VSWorkerPool::isSupported()) {
+            std::cerr << "Timeouts can not be used in batch mode, since workers are not supported on this platform." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        if (getOptionAsString("timings") || tracePath) {
+            std::cerr << "Timeouts in batch mode run documents in workers, timings and trace can not be collected from them." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        workerCount = 1;
+    }
+
+    VSMemoryTrimmer::Policy trimPolicy;
+    trimPolicy.target = *tryGetOptionAs<int>(optionValues, "trim-target");
+    if (auto documentCount = tryGetOptionAs<int>(optionValues, "trim-after"))
+    {
+        if (*documentCount <= 0) {
+            std::cerr << "Trim documents count must be positive." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        trimPolicy.documentCount = documentCount;
+    }
+    if (auto idleSeconds = tryGetOptionAs<double>(optionValues, "trim-idle"))
+    {
+        if (*idleSeconds <= 0) {
+            std::cerr << "Trim idle time must be positive." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        trimPolicy.idleTime = std::chrono::milliseconds(static_cast<long long>(*idleSeconds * 1000));
+    }
+    if (auto watermark = getOptionAsString("trim-rss"))
+    {
+        trimPolicy.residentSetSizeWatermark = parseMegabytes(*watermark);
+        if (!trimPolicy.residentSetSizeWatermark) {
+            std::cerr << "Invalid resident set size watermark " << *watermark << "." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+
+    std::optional<VSMetrics> metrics;
+    if (metricsPath) {
+        metrics.emplace();
+    }
+    std::optional<VSProfiler> profiler;
+    if (getOptionAsString("timings") || tracePath || metrics)
+    {
+        profiler.emplace(getOptionAsString("timings") || tracePath);
+        if (metrics)
         {
-            auto filePath = getOptionAsString("file");
-            if (!filePath) {
-                return VSLibreOffice::Error("Path to file must be provided to perform conversion or exporting");
+            profiler->addListener([&metrics](const VSProfiler::Span& span) {
+                metrics->observe(span.stage, span.wallTime);
+            });
+        }
+    }
+    VSProfiler* profilerPtr = profiler ? &*profiler : nullptr;
+    VSMetrics* metricsPtr = metrics ? &*metrics : nullptr;
+
+    DocumentTask task;
+    if (auto convertFormats = getOptionAsString("convert-to"))
+    {
+        for (const auto& format : splitList(*convertFormats)) {
+            task.conversions.push_back({format, std::nullopt});
+        }
+        if (task.conversions.empty()) {
+            std::cerr << "Conversion formats are not specified." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+    if (auto outputFiles = tryGetOptionAs<std::vector<std::string>>(optionValues, "output-file"))
+    {
+        if (outputFiles->size() != task.conversions.size()) {
+            std::cerr << "Output file must be specified for each conversion format." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        for (size_t i = 0; i < outputFiles->size(); ++i) {
+            task.conversions[i].outputFile = (*outputFiles)[i];
+        }
+    }
+    task.exportFormat = getOptionAsString("export-as-images");
+    task.tilesFormat = getOptionAsString("export-as-tiles");
+    task.tilePyramid.tileSize = *tryGetOptionAs<int>(optionValues, "tile-size");
+    task.tilePyramid.dpi = *tryGetOptionAs<double>(optionValues, "tile-dpi");
+    if (task.tilePyramid.tileSize <= 0 || task.tilePyramid.dpi <= 0) {
+        std::cerr << "Tile size and dpi must be positive." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    assert(getOptionAsString("output-dir"));
+    task.outputDir = *getOptionAsString("output-dir");
+    if (auto textFile = getOptionAsString("extract-text")) {
+        task.textFile = *textFile;
+    }
+    assert(getOptionAsString("filter-cache"));
+    auto filterCachePath = *getOptionAsString("filter-cache");
+    //Filters known from previous runs are used without initializing LibreOffice.
+    std::optional<VSInstalledFilters> installedFilters;
+    if (auto libreOfficePath = getOptionAsString("libre-office")) {
+        installedFilters = VSInstalledFilters::load(filterCachePath, *libreOfficePath);
+    }
+    const VSInstalledFilters* installedFiltersPtr = installedFilters ? &*installedFilters : nullptr;
+    for (const auto& conversion : task.conversions)
+    {
+        //Impossible conversion is reported before LibreOffice is initialized and document is loaded.
+        auto filePath = getOptionAsString("file");
+        auto error = batchListPath || !filePath
+            ? checkConversion(conversion.format, "", installedFiltersPtr)
+            : checkConversion(conversion.format, *filePath, installedFiltersPtr);
+        if (error) {
+            std::cerr << *error << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+    if (auto resolutions = getOptionAsString("resolutions"))
+    {
+        if (!optionValues["resolution"].defaulted()) {
+            std::cerr << "Resolution and resolutions can not be specified together." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        for (const auto& item : splitList(*resolutions))
+        {
+            auto resolution = parseResolution(item);
+            if (!resolution) {
+                return invalidArgumentErrorReturnCode;
             }
-            auto error = libreOffice.open(*filePath);
-            if (error) {
-                return error;
+            bool isDuplicate = std::any_of(task.resolutions.begin(), task.resolutions.end(), [&](const Resolution& other) {
+                return other.width == resolution->width && other.height == resolution->height;
+            });
+            if (resolution->width == 0 || resolution->height == 0 || isDuplicate) {
+                std::cerr << "Resolutions must be distinct and not empty." << std::endl;
+                return invalidArgumentErrorReturnCode;
             }
+            task.resolutions.push_back(*resolution);
+        }
+        if (task.resolutions.empty()) {
+            std::cerr << "Resolutions are not specified." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+    else if (task.exportFormat)
+    {
+        assert(getOptionAsString("resolution"));
+        if (auto resolution = parseResolution(*getOptionAsString("resolution"))) {
+            task.resolutions.push_back(*resolution);
+        }
+        else {
+            task.exportFormat.reset();
         }
+    }
 
-        return std::nullopt;
+    VSImageExporter::Settings exportSettings;
+    exportSettings.encodeThreads = *tryGetOptionAs<unsigned>(optionValues, "encode-threads");
+    exportSettings.supersample = *tryGetOptionAs<int>(optionValues, "supersample");
+    exportSettings.renderTimeout = renderTimeout;
+    assert(getOptionAsString("pixel-format"));
+    if (auto pixelFormat = *getOptionAsString("pixel-format"); pixelFormat == "gray8") {
+        exportSettings.pixelFormat = VSImageExporter::PixelFormat::gray8;
+    }
+    else if (pixelFormat == "indexed8") {
+        exportSettings.pixelFormat = VSImageExporter::PixelFormat::indexed8;
+    }
+    else if (pixelFormat != "argb32") {
+        std::cerr << "Invalid pixel format " << pixelFormat << ", expected argb32, gray8 or indexed8." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    if (auto deduplication = getOptionAsString("dedup"))
+    {
+        if (*deduplication == "link") {
+            exportSettings.deduplication = VSImageExporter::Deduplication::link;
+        }
+        else if (*deduplication == "manifest") {
+            exportSettings.deduplication = VSImageExporter::Deduplication::manifest;
+        }
+        else {
+            std::cerr << "Invalid deduplication mode " << *deduplication << ", expected link or manifest." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+    if (auto background = getOptionAsString("background"))
+    {
+        exportSettings.background = parseColor(*background);
+        if (!exportSettings.background) {
+            std::cerr << "Invalid background color " << *background << ", expected #RRGGBB." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+    }
+    if (exportSettings.supersample != 1 && exportSettings.supersample != 2 && exportSettings.supersample != 4) {
+        std::cerr << "Invalid supersample factor " << exportSettings.supersample << ", expected 1, 2 or 4." << std::endl;
+        return invalidArgumentErrorReturnCode;
+    }
+    if (auto memoryBudget = getOptionAsString("memory-budget"))
+    {
+        auto budgetBytes = parseMegabytes(*memoryBudget);
+        if (!budgetBytes) {
+            std::cerr << "Invalid memory budget " << *memoryBudget << "." << std::endl;
+            return invalidArgumentErrorReturnCode;
+        }
+        exportSettings.memoryBudget = *budgetBytes;
+    }
+    //Not created before workers are forked, since its thread does not survive fork.
+    std::optional<VSWatchdog> watchdog;
+    //Created once, so budget is shared by all documents of batch.
+    std::optional<VSImageExporter> imageExporter;
+    //Not created before workers are forked, since threads of encoding pool do not survive fork.
+    auto createImageExporter = [&]()
+    {
+        if (task.exportsImages())
+        {
+            imageExporter.emplace(exportSettings, profilerPtr, metricsPtr, watchdog ? &*watchdog : nullptr, [&](const std::string& cause, const std::string& message) {
+                reportFailure(metricsPtr, cause, message);
+            });
+        }
     };
 
-    if (auto convertFormat = getOptionAsString("convert-to"))
-    {
-        auto initError = tryInitLibreOfficeAndOpenFile();
-        if (!initError)
+    //Declared before office, so it is removed after office exits.
+    VSUserProfile userProfile;
+    VSLibreOffice libreOffice;
+    libreOffice.setProfiler(profilerPtr);
+    libreOffice.setErrorListener([](const VSLibreOffice::Error& error) {
+        std::cerr << "LibreOffice error: " << error.message() << std::endl;
+    });
+    libreOffice.setFontsMissingListener([&metrics](const std::vector<std::string>& fontFamilies) {
+        std::string fonts;
+        for (const auto& fontFamily : fontFamilies)
         {
-            assert(libreOffice.isInited());
-            assert(libreOffice.isOpened());
-            boost::filesystem::path outputPath;
-            if (auto outputPathInOptions = getOptionAsString("output-file")) {
-                outputPath = *std::move(outputPathInOptions);
+            fonts += (fonts.empty() ? "" : ", ") + fontFamily;
+            if (metrics) {
+                metrics->fontMissing(fontFamily);
             }
-            else
+        }
+        std::cerr << "Fonts substituted by fallback: " << fonts << std::endl;
+    });
+    if (optionValues.count("progress"))
+    {
+        libreOffice.setProgressListener([](const VSLibreOffice::Progress& progress) {
+            switch (progress.stage)
             {
-                assert(getOptionAsString("file"));
-                outputPath = *getOptionAsString("file");
-                outputPath.replace_extension(*convertFormat);
+            case VSLibreOffice::Progress::Stage::Start:
+                std::cerr << (progress.text.empty() ? "Started" : progress.text) << std::endl;
+                break;
+            case VSLibreOffice::Progress::Stage::Value:
+                std::cerr << progress.percent << "%" << std::endl;
+                break;
+            case VSLibreOffice::Progress::Stage::Finish:
+                std::cerr << "Finished" << std::endl;
+                break;
             }
-            auto error = libreOffice.saveAs(outputPath.generic_string(), *convertFormat);
-            if (error) {
-                std::cerr << error->message() << std::endl;
+        });
+    }
+    auto tryInitLibreOffice = [&]() -> std::optional<VSLibreOffice::Error>
+    {
+        if (libreOffice.isInited()) {
+            return std::nullopt;
+        }
+        auto libreOfficePath = getOptionAsString("libre-office");
+        if (!libreOfficePath) {
+            return VSLibreOffice::Error("Path to libre office installation must be provided to perform conversion or exporting");
+        }
+        //Workers use profile created before LibreOffice is preinitialized.
+        if (auto profileTemplate = getOptionAsString("profile-template"); profileTemplate && !userProfile.isCreated())
+        {
+            VSProfiler::Scope scope(profilerPtr, "profileCopy");
+            if (auto profileError = userProfile.createFromTemplate(*profileTemplate)) {
+                return profileError;
             }
         }
-        else {
-            std::cerr << initError->message() << std::endl;
+        std::optional<std::string> userProfilePath;
+        if (userProfile.isCreated()) {
+            userProfilePath = userProfile.path();
         }
-    }
-
-    if (auto exportFormat = getOptionAsString("export-as-images"))
+        auto error = libreOffice.init(*libreOfficePath, userProfilePath);
+        if (error) {
+            return error;
+        }
+        if (tracePath) {
+            libreOffice.startProfileZoneRecording();
+        }
+        if (!fontFiles.empty())
+        {
+            VSProfiler::Scope scope(profilerPtr, "addFonts");
+            for (const auto& fontFile : fontFiles) {
+                libreOffice.addFont(fontFile);
+            }
+        }
+        if (!installedFilters)
+        {
+            installedFilters = VSInstalledFilters::query(libreOffice, *libreOfficePath);
+            installedFiltersPtr = installedFilters ? &*installedFilters : nullptr;
+            if (installedFilters && !installedFilters->save(filterCachePath)) {
+                std::cerr << "Unable to write filter cache " << filterCachePath << std::endl;
+            }
+        }
+        return std::nullopt;
+    };
+    auto preinitLibreOffice = [&]() -> std::optional<VSLibreOffice::Error>
     {
-        struct Resolution {
-            int width;
-            int height;
-        };
-        //Parse resoltion settings.
-        assert(getOptionAsString("resolution"));
-        std::string sresolution = *getOptionAsString("resolution");
-        std::optional<Resolution> resolution;
-        try {
-            auto separatorPos = sresolution.find("x", 0);
-            if (separatorPos == decltype(sresolution)::npos) {
-                throw std::invalid_argument("");
+        auto libreOfficePath = getOptionAsString("libre-office");
+        if (!libreOfficePath) {
+            return VSLibreOffice::Error("Path to libre office installation must be provided to perform conversion or exporting");
+        }
+        std::optional<std::string> userProfilePath;
+        if (auto profileTemplate = getOptionAsString("profile-template"))
+        {
+            if (auto profileError = userProfile.createFromTemplate(*profileTemplate)) {
+                return profileError;
             }
-            int width = std::stoi(sresolution.substr(0, separatorPos));
-            int height = std::stoi(sresolution.substr(separatorPos + 1));
-            if (width < 0 || height < 0) {
-                throw std::out_of_range("");
+            userProfilePath = userProfile.path();
+        }
+        return VSLibreOffice::preinit(*libreOfficePath, userProfilePath);
+    };
+    //Read by watchdog thread, which is synchronized with stages it watches.
+    std::string currentDocument;
+    auto processFile = [&](const std::string& filePath, DocumentTask documentTask)
+    {
+        currentDocument = filePath;
+        if (!documentTask.conversions.empty())
+        {
+            auto impossible = std::remove_if(documentTask.conversions.begin(), documentTask.conversions.end(), [&](const Conversion& conversion)
+            {
+                auto error = checkConversion(conversion.format, filePath, installedFiltersPtr);
+                if (error) {
+                    reportFailure(metricsPtr, "format", *error);
+                }
+                return error.has_value();
+            });
+            documentTask.conversions.erase(impossible, documentTask.conversions.end());
+            if (documentTask.isEmpty()) {
+                return;
             }
-            resolution = Resolution{width, height};
         }
-        catch (const std::invalid_argument&)
+        std::optional<VSLibreOffice::Error> openError;
         {
-            std::cerr << "Invalid resolution format." << std::endl;
+            VSWatchdog::Scope watch(watchdog ? &*watchdog : nullptr, "documentLoad", loadTimeout);
+            openError = libreOffice.open(filePath);
         }
-        catch (const std::out_of_range&)
+        if (openError) {
+            reportFailure(metricsPtr, "load", openError->message());
+            return;
+        }
+        for (const auto& conversion : documentTask.conversions)
         {
-            std::cerr << "Resolution is out of possible range." << std::endl;
+            VSWatchdog::Scope watch(watchdog ? &*watchdog : nullptr, "saveAs", saveTimeout);
+            convertDocument(libreOffice, filePath, conversion, metricsPtr);
+        }
+        if (documentTask.textFile) {
+            extractText(libreOffice, *documentTask.textFile, metricsPtr, watchdog ? &*watchdog : nullptr, renderTimeout);
+        }
+        if (documentTask.exportFormat) {
+            assert(!documentTask.resolutions.empty());
+            imageExporter->exportDocument(
+                libreOffice, *documentTask.exportFormat, documentTask.resolutions, documentTask.outputDir
+            );
+        }
+        if (documentTask.tilesFormat) {
+            imageExporter->exportTiles(libreOffice, *documentTask.tilesFormat, documentTask.tilePyramid, documentTask.outputDir);
+        }
+        libreOffice.close();
+        if (metrics) {
+            metrics->documentProcessed();
+        }
+    };
+    auto writeMetrics = [&]()
+    {
+        if (metrics && !metrics->writeToFile(*metricsPath)) {
+            std::cerr << "Unable to write metrics to " << *metricsPath << std::endl;
+        }
+    };
+
+    bool isWorker = false;
+    auto createWatchdog = [&]()
+    {
+        if (!loadTimeout && !renderTimeout && !saveTimeout) {
+            return;
         }
+        watchdog.emplace([&](const std::string& stage, int part, std::chrono::milliseconds timeout)
+        {
+            std::string message = "Timeout of " + stage + (part == VSProfiler::noPart ? "" : " of part " + std::to_string(part))
+                + " of " + currentDocument + " after " + std::to_string(timeout.count()) + " ms";
+            //Worker is replaced, while document is reported by current process.
+            if (isWorker) {
+                VSWorkerPool::abortDocument("timeout", message);
+            }
+            reportFailure(metricsPtr, "timeout", message);
+            writeMetrics();
+            std::cout.flush();
+            //Main thread is blocked in LibreOffice, so nothing is destroyed.
+            std::_Exit(timeoutErrorReturnCode);
+        });
+    };
 
-        if (resolution) {
-            auto initError = tryInitLibreOfficeAndOpenFile();
-            if (!initError)
+    std::optional<VSMemoryTrimmer> trimmer;
+    auto createTrimmer = [&]()
+    {
+        if (!trimPolicy.isEnabled()) {
+            return;
+        }
+        trimmer.emplace(libreOffice, trimPolicy, [&](const std::string& reason, std::optional<size_t> before, std::optional<size_t> after)
+        {
+            auto megabytes = [](std::optional<size_t> bytes) {
+                return bytes ? std::to_string(*bytes / (1024 * 1024)) : std::string("?");
+            };
+            std::cerr << "trimMemory after " << reason << ": RSS "
+                      << megabytes(before) << " MB -> " << megabytes(after) << " MB" << std::endl;
+            if (metrics) {
+                metrics->memoryTrimmed(reason, before && after ? static_cast<long long>(*before) - static_cast<long long>(*after) : 0);
+            }
+        });
+    };
+    auto processListedDocument = [&](const std::string& document)
+    {
+        if (trimmer) {
+            trimmer->idleEnd();
+        }
+        DocumentTask documentTask = task;
+        documentTask.outputDir /= documentDirectoryName(document);
+        if (documentTask.textFile) {
+            documentTask.textFile = documentTask.outputDir / documentTask.textFile->filename();
+        }
+        boost::system::error_code error;
+        if ((documentTask.exportsImages() || documentTask.textFile) && !boost::filesystem::create_directories(documentTask.outputDir, error) && error) {
+            reportFailure(metricsPtr, "write", "Unable to create directory " + documentTask.outputDir.generic_string());
+            documentTask.exportFormat.reset();
+            documentTask.tilesFormat.reset();
+            documentTask.textFile.reset();
+        }
+        processFile(document, documentTask);
+        if (trimmer)
+        {
+            trimmer->documentProcessed();
+            trimmer->idleBegin();
+        }
+        writeMetrics();
+    };
+
+    int returnCode = 0;
+    if (optionValues.count("list-filters"))
+    {
+        if (!installedFilters)
+        {
+            if (auto initError = tryInitLibreOffice()) {
+                reportFailure(metricsPtr, "init", initError->message());
+                returnCode = libreOfficeErrorReturnCode;
+            }
+            else if (!installedFilters) {
+                std::cerr << "LibreOffice does not provide filter types" << std::endl;
+                returnCode = libreOfficeErrorReturnCode;
+            }
+        }
+        if (installedFilters)
+        {
+            for (const auto& fileType : installedFilters->fileTypes())
+            {
+                auto catalogFilter = VSFilterCatalog::findByFileType(fileType.name);
+                std::cout << fileType.name << "\t" << fileType.mediaType << "\t"
+                          << (catalogFilter ? catalogFilter->extension : "") << std::endl;
+            }
+        }
+    }
+    if (!task.isEmpty() && workerCount)
+    {
+        if (auto preinitError = preinitLibreOffice()) {
+            reportFailure(metricsPtr, "init", preinitError->message());
+            returnCode = libreOfficeErrorReturnCode;
+        }
+        else
+        {
+            //Each worker writes own metrics next to metrics of current process, which counts crashes.
+            auto workerMetricsPath = [basePath = metricsPath](unsigned number) -> std::optional<std::string> {
+                if (!basePath) {
+                    return std::nullopt;
+                }
+                boost::filesystem::path path = *basePath;
+                return (path.parent_path() / (path.stem().string() + ".worker" + std::to_string(number) + path.extension().string())).string();
+            };
+            VSWorkerPool::Worker worker;
+            worker.start = [&](unsigned number)
             {
-                assert(libreOffice.isInited());
-                assert(libreOffice.isOpened());
-                assert(getOptionAsString("output-dir"));
-                boost::filesystem::path outputDir(*getOptionAsString("output-dir"));
-                for (int i = 0; i < libreOffice.partCount(); ++i)
+                metricsPath = workerMetricsPath(number);
+                if (metrics) {
+                    metrics.emplace();
+                }
+                isWorker = true;
+                if (auto initError = tryInitLibreOffice())
+                {
+                    reportFailure(metricsPtr, "init", initError->message());
+                    writeMetrics();
+                    return false;
+                }
+                createWatchdog();
+                createImageExporter();
+                createTrimmer();
+                return true;
+            };
+            worker.process = processListedDocument;
+            worker.stop = [&]()
+            {
+                if (trimmer)
                 {
-                    libreOffice.setPart(i);
-                    assert(resolution);
-                    std::vector<unsigned char> buffer; buffer.reserve(resolution->width * resolution->height * VSLibreOffice::bytesPerPixel);
-                    libreOffice.renderPart(resolution->width, resolution->height, buffer.data());
-                    QImage image(buffer.data(), resolution->width, resolution->height, QImage::Format::Format_ARGB32);
-                    std::string outputPath = boost::filesystem::path(outputDir).append(std::to_string(i) + "." + *exportFormat).generic_string();
-                    if (!image.save(QString::fromStdString(outputPath))) {
-                        std::cerr << "Unable to save " << outputPath << std::endl;
-                    }
+                    trimmer->idleEnd();
+                    trimmer.reset();
                 }
+                imageExporter.reset();
+                watchdog.reset();
+                libreOffice.deinit();
+                writeMetrics();
+            };
+            VSWorkerPool workerPool(*workerCount, worker, [&](const std::string& document, const std::string& cause, const std::string& reason)
+            {
+                reportFailure(metricsPtr, cause, "Processing of " + document + " failed: " + reason);
+                writeMetrics();
+            });
+            bool isListRead = forEachListedDocument(*batchListPath, [&](const std::string& document) {
+                workerPool.process(document);
+            });
+            workerPool.finish();
+            if (!isListRead) {
+                std::cerr << "Unable to read document list " << *batchListPath << std::endl;
+                returnCode = invalidArgumentErrorReturnCode;
             }
-            else {
-                std::cerr << initError->message() << std::endl;
+        }
+    }
+    else if (!task.isEmpty())
+    {
+        if (auto initError = tryInitLibreOffice()) {
+            reportFailure(metricsPtr, "init", initError->message());
+            returnCode = libreOfficeErrorReturnCode;
+        }
+        else if (batchListPath)
+        {
+            createImageExporter();
+            createTrimmer();
+            bool isListRead = forEachListedDocument(*batchListPath, processListedDocument);
+            if (trimmer)
+            {
+                trimmer->idleEnd();
+                trimmer.reset();
             }
+            if (!isListRead) {
+                std::cerr << "Unable to read document list " << *batchListPath << std::endl;
+                returnCode = invalidArgumentErrorReturnCode;
+            }
+        }
+        else if (auto filePath = getOptionAsString("file"))
+        {
+            createWatchdog();
+            createImageExporter();
+            processFile(*filePath, task);
+        }
+        else {
+            std::cerr << "Path to file must be provided to perform conversion or exporting" << std::endl;
+        }
+    }
+    writeMetrics();
+
+    if (tracePath)
+    {
+        std::vector<std::string> profileZoneEvents;
+        if (libreOffice.isInited())
+        {
+            libreOffice.stopProfileZoneRecording();
+            libreOffice.deinit();
+            profileZoneEvents = libreOffice.takeProfileZoneEvents();
+        }
+        std::ofstream traceFile(*tracePath);
+        writeChromeTrace(traceFile, *profiler, profileZoneEvents);
+        if (!traceFile) {
+            std::cerr << "Unable to write trace to " << *tracePath << std::endl;
         }
     }
+    if (getOptionAsString("timings")) {
+        writeTimingsReport(std::cout, profiler->spans(), jsonTimings);
+    }
 
     //if(result != QPdfDocument::NoError) {
     //   std::cerr << QMetaEnum::fromType<QPdfDocument::DocumentError>().valueToKey(result) << std::endl;
@@ -279,5 +1399,5 @@ int main(int argc, char** argv)
     //   return 4;
     //}
 
-    return 0;
+    return returnCode;
 }